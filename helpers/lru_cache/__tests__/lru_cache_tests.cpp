@@ -0,0 +1,96 @@
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../../run_test.h"
+#include "../lru_cache.h"
+
+using namespace std;
+
+void TestLeastRecentlyUsedEviction() {
+    // a single shard of three entries
+    LruCache<int, string> cache(30, 1);
+    cache.Put(1, "one"s, 10);
+    cache.Put(2, "two"s, 10);
+    cache.Put(3, "three"s, 10);
+
+    string value;
+    ASSERT(cache.Get(1, value));
+    ASSERT_EQUAL(value, "one"s);
+
+    // 2 is the least recently used one now
+    cache.Put(4, "four"s, 10);
+    ASSERT(!cache.Get(2, value));
+    ASSERT(cache.Get(1, value));
+    ASSERT(cache.Get(3, value));
+    ASSERT(cache.Get(4, value));
+    ASSERT_EQUAL(cache.GetSize(), 3u);
+    ASSERT_EQUAL(cache.GetByteCount(), 30u);
+}
+
+void TestByteCounts() {
+    LruCache<int, string> cache(100, 1);
+    cache.Put(1, "a"s, 40);
+    cache.Put(2, "b"s, 40);
+
+    // replacing a value replaces its byte count
+    cache.Put(1, "c"s, 10);
+    ASSERT_EQUAL(cache.GetByteCount(), 50u);
+
+    // a big entry evicts as many as it needs, from the least recently used one
+    cache.Put(3, "d"s, 90);
+    string value;
+    ASSERT(!cache.Get(2, value));
+    ASSERT(cache.Get(1, value));
+    ASSERT_EQUAL(cache.GetByteCount(), 100u);
+
+    // an entry bigger than the cache isn't kept, and evicts nothing
+    cache.Put(4, "e"s, 101);
+    ASSERT(!cache.Get(4, value));
+    ASSERT(cache.Get(3, value));
+    cache.Erase(1);
+    cache.Erase(3);
+    ASSERT_EQUAL(cache.GetSize(), 0u);
+
+    cache.Put(5, "f"s, 10);
+    cache.Erase(5);
+    cache.Erase(6);
+    ASSERT_EQUAL(cache.GetByteCount(), 0u);
+
+    cache.Put(7, "g"s, 10);
+    cache.Clear();
+    ASSERT(!cache.Get(7, value));
+    ASSERT_EQUAL(cache.GetSize(), 0u);
+}
+
+void TestConcurrentAccess() {
+    LruCache<int, int> cache(1000, 8);
+
+    vector<thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&cache, t]() {
+            for (int i = 0; i < 20000; ++i) {
+                const int key = (i * 7 + t) % 300;
+                int value = 0;
+
+                if (cache.Get(key, value)) {
+                    ASSERT_EQUAL(value, key * 2);
+                } else {
+                    cache.Put(key, key * 2, 1);
+                }
+            }
+        });
+    }
+    for (thread& thread : threads) {
+        thread.join();
+    }
+
+    ASSERT(cache.GetSize() <= 1000u);
+    ASSERT_EQUAL(cache.GetByteCount(), cache.GetSize());
+}
+
+int main() {
+    RUN_TEST(TestLeastRecentlyUsedEviction);
+    RUN_TEST(TestByteCounts);
+    RUN_TEST(TestConcurrentAccess);
+}
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Least recently used cache split into shards by the key's hash, every shard with a mutex of its
+// own, so threads touching different shards don't wait for each other. Entries are accounted by
+// the byte counts they are put with, and every shard keeps its share of max_byte_count
+template <typename Key, typename Value, typename Hash = std::hash<Key>>
+class LruCache {
+   public:
+    LruCache(size_t max_byte_count, size_t shard_count)
+        : max_shard_byte_count_(max_byte_count / std::max(shard_count, static_cast<size_t>(1))),
+          shards_(std::max(shard_count, static_cast<size_t>(1))) {
+    }
+
+    // copies the key's value and makes it the most recently used one
+    bool Get(const Key& key, Value& value) {
+        Shard& shard = GetShard(key);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+
+        const auto it = shard.positions.find(key);
+        if (it == shard.positions.end()) {
+            return false;
+        }
+
+        shard.entries.splice(shard.entries.begin(), shard.entries, it->second);
+        value = it->second->value;
+        return true;
+    }
+
+    // evicts the least recently used entries of the shard until the new one fits,
+    // an entry bigger than a shard's share isn't kept at all
+    void Put(const Key& key, Value value, size_t byte_count) {
+        Shard& shard = GetShard(key);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+
+        EraseEntry(shard, key);
+        if (byte_count > max_shard_byte_count_) {
+            return;
+        }
+
+        while (shard.byte_count + byte_count > max_shard_byte_count_) {
+            EraseEntry(shard, shard.entries.back().key);
+        }
+
+        shard.entries.push_front({key, std::move(value), byte_count});
+        shard.positions.emplace(key, shard.entries.begin());
+        shard.byte_count += byte_count;
+    }
+
+    void Erase(const Key& key) {
+        Shard& shard = GetShard(key);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+
+        EraseEntry(shard, key);
+    }
+
+    void Clear() {
+        for (Shard& shard : shards_) {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+
+            shard.positions.clear();
+            shard.entries.clear();
+            shard.byte_count = 0;
+        }
+    }
+
+    size_t GetSize() const {
+        size_t size = 0;
+        for (const Shard& shard : shards_) {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            size += shard.entries.size();
+        }
+
+        return size;
+    }
+
+    size_t GetByteCount() const {
+        size_t byte_count = 0;
+        for (const Shard& shard : shards_) {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            byte_count += shard.byte_count;
+        }
+
+        return byte_count;
+    }
+
+   private:
+    struct Entry {
+        Key key;
+        Value value;
+        size_t byte_count;
+    };
+
+    struct Shard {
+        mutable std::mutex mutex;
+        std::list<Entry> entries;  // from the most recently used one
+        std::unordered_map<Key, typename std::list<Entry>::iterator, Hash> positions;
+        size_t byte_count = 0;
+    };
+
+    size_t max_shard_byte_count_;
+    std::vector<Shard> shards_;
+    Hash hash_;
+
+    Shard& GetShard(const Key& key) {
+        return shards_[hash_(key) % shards_.size()];
+    }
+
+    static void EraseEntry(Shard& shard, const Key& key) {
+        const auto it = shard.positions.find(key);
+        if (it == shard.positions.end()) {
+            return;
+        }
+
+        shard.byte_count -= it->second->byte_count;
+        shard.entries.erase(it->second);
+        shard.positions.erase(it);
+    }
+};
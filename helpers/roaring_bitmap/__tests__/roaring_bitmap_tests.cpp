@@ -0,0 +1,120 @@
+#include <cstdint>
+#include <random>
+#include <set>
+#include <vector>
+
+#include "../../run_test.h"
+#include "../roaring_bitmap.h"
+
+using namespace std;
+
+void CheckSame(const RoaringBitmap& bitmap, const set<uint32_t>& expected, uint32_t max_value) {
+    ASSERT_EQUAL(bitmap.GetCardinality(), expected.size());
+    ASSERT_EQUAL(bitmap.IsEmpty(), expected.empty());
+
+    for (uint32_t value = 0; value <= max_value; value += 7) {
+        ASSERT_EQUAL(bitmap.Contains(value), expected.count(value) > 0u);
+    }
+    for (const uint32_t value : expected) {
+        ASSERT(bitmap.Contains(value));
+    }
+}
+
+void TestAddAndContains() {
+    RoaringBitmap bitmap;
+    ASSERT(bitmap.IsEmpty());
+    ASSERT(!bitmap.Contains(0));
+
+    // sparse values stay in arrays and dense ones become bitmaps
+    mt19937 generator(1);
+    set<uint32_t> expected;
+    for (int i = 0; i < 20000; ++i) {
+        const uint32_t value = i % 2 == 0 ? generator() % 300000u : 1000000u + generator() % 5000u;
+
+        bitmap.Add(value);
+        expected.insert(value);
+    }
+    bitmap.Add(UINT32_MAX);
+    expected.insert(UINT32_MAX);
+
+    CheckSame(bitmap, expected, 1100000);
+    ASSERT(bitmap.Contains(UINT32_MAX));
+}
+
+void TestUnion() {
+    mt19937 generator(2);
+
+    for (int round = 0; round < 20; ++round) {
+        RoaringBitmap lhs;
+        RoaringBitmap rhs;
+        set<uint32_t> expected;
+
+        for (int i = 0; i < 3000 * round; ++i) {
+            const uint32_t value = generator() % 400000u;
+            (i % 3 == 0 ? lhs : rhs).Add(value);
+            expected.insert(value);
+        }
+
+        lhs |= rhs;
+        CheckSame(lhs, expected, 400000);
+    }
+}
+
+void TestClearKeepsWorking() {
+    RoaringBitmap bitmap;
+
+    for (uint32_t round = 0; round < 3; ++round) {
+        set<uint32_t> expected;
+
+        for (uint32_t value = round * 70000; value < round * 70000 + 10000 * (round + 1); value += round + 1) {
+            bitmap.Add(value);
+            expected.insert(value);
+        }
+
+        CheckSame(bitmap, expected, 300000);
+        bitmap.Clear();
+        ASSERT(bitmap.IsEmpty());
+        ASSERT(!bitmap.Contains(round * 70000));
+    }
+}
+
+void TestSortedLookup() {
+    mt19937 generator(3);
+
+    for (int round = 0; round < 10; ++round) {
+        // sparse and dense containers with gaps between them
+        RoaringBitmap bitmap;
+        for (int i = 0; i < 20000; ++i) {
+            const uint32_t value = i % 2 == 0 ? generator() % 300000u : 500000u + generator() % (2000u * round + 1);
+            bitmap.Add(value);
+        }
+        if (round % 2 == 0) {
+            bitmap.Add(UINT32_MAX);
+        }
+
+        // ascending values with repeats and jumps of different lengths
+        RoaringBitmap::SortedLookup lookup(bitmap);
+        uint32_t value = 0;
+        while (true) {
+            ASSERT_EQUAL(lookup.Contains(value), bitmap.Contains(value));
+            if (value == UINT32_MAX) {
+                break;
+            }
+
+            const uint32_t step = generator() % 8 == 0 ? generator() % 100000u : generator() % 4u;
+            value = step >= UINT32_MAX - value ? UINT32_MAX : value + step;
+        }
+    }
+
+    RoaringBitmap empty;
+    RoaringBitmap::SortedLookup lookup(empty);
+    ASSERT(!lookup.Contains(0));
+    ASSERT(!lookup.Contains(UINT32_MAX));
+}
+
+int main() {
+    RUN_TEST(TestAddAndContains);
+    RUN_TEST(TestUnion);
+    RUN_TEST(TestClearKeepsWorking);
+    RUN_TEST(TestSortedLookup);
+}
@@ -0,0 +1,246 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <vector>
+
+// Compressed set of 32-bit values. Values are grouped by their high 16 bits into containers,
+// a container is a sorted array of the low bits while it's sparse and a 2^16 bit bitmap when
+// it's dense. So a set takes at most 2 bytes per value and 8 KB per 2^16 values, and a lookup
+// is a search among containers followed by a bit test or a search in a small array.
+// Clear keeps the memory of containers, so a reused bitmap stops allocating
+class RoaringBitmap {
+    struct Container;
+
+   public:
+    // Contains for ascending values, such as the ordinals of a posting list. The current container
+    // and the position in its array are kept between lookups, so the containers aren't searched
+    // again and an array is galloped through from where the previous value stopped. The bitmap
+    // mustn't change while a lookup is used
+    class SortedLookup {
+       public:
+        explicit SortedLookup(const RoaringBitmap& bitmap) : bitmap_(bitmap) {
+        }
+
+        // value mustn't be less than the previous one
+        bool Contains(uint32_t value) {
+            const uint16_t key = static_cast<uint16_t>(value >> 16);
+            while (index_ < bitmap_.container_count_ && bitmap_.containers_[index_].key < key) {
+                ++index_;
+                position_ = 0;
+            }
+            if (index_ == bitmap_.container_count_ || bitmap_.containers_[index_].key != key) {
+                return false;
+            }
+
+            const Container& container = bitmap_.containers_[index_];
+            const uint16_t low = static_cast<uint16_t>(value);
+            if (container.is_bitmap) {
+                return ((container.words[low / 64] >> (low % 64)) & 1u) != 0u;
+            }
+
+            const std::vector<uint16_t>& values = container.values;
+            size_t step = 1;
+            while (position_ + step < values.size() && values[position_ + step] < low) {
+                step *= 2;
+            }
+            const auto first = values.begin() + position_ + step / 2;
+            const auto last = values.begin() + std::min(position_ + step + 1, values.size());
+            position_ = std::lower_bound(first, last, low) - values.begin();
+
+            return position_ < values.size() && values[position_] == low;
+        }
+
+       private:
+        const RoaringBitmap& bitmap_;
+        size_t index_ = 0;
+        size_t position_ = 0;
+    };
+
+    void Add(uint32_t value) {
+        Container& container = GetOrInsertContainer(static_cast<uint16_t>(value >> 16));
+        const uint16_t low = static_cast<uint16_t>(value);
+
+        if (container.is_bitmap) {
+            AddToBitmap(container, low);
+        } else if (container.values.empty() || container.values.back() < low) {
+            // values usually come sorted
+            container.values.push_back(low);
+        } else {
+            const auto position = std::lower_bound(container.values.begin(), container.values.end(), low);
+
+            if (*position != low) {
+                container.values.insert(position, low);
+            }
+        }
+
+        if (!container.is_bitmap && container.values.size() > MAX_ARRAY_SIZE) {
+            ConvertToBitmap(container);
+        }
+    }
+
+    bool Contains(uint32_t value) const {
+        const Container* container = FindContainer(static_cast<uint16_t>(value >> 16));
+        if (container == nullptr) {
+            return false;
+        }
+
+        const uint16_t low = static_cast<uint16_t>(value);
+        if (container->is_bitmap) {
+            return ((container->words[low / 64] >> (low % 64)) & 1u) != 0u;
+        }
+
+        return std::binary_search(container->values.begin(), container->values.end(), low);
+    }
+
+    RoaringBitmap& operator|=(const RoaringBitmap& other) {
+        for (size_t i = 0; i < other.container_count_; ++i) {
+            const Container& source = other.containers_[i];
+            Container& container = GetOrInsertContainer(source.key);
+
+            if (source.is_bitmap && !container.is_bitmap) {
+                ConvertToBitmap(container);
+            }
+
+            if (container.is_bitmap) {
+                if (source.is_bitmap) {
+                    for (size_t word = 0; word < BITMAP_WORD_COUNT; ++word) {
+                        container.words[word] |= source.words[word];
+                    }
+                    container.cardinality = CountBits(container.words);
+                } else {
+                    for (const uint16_t low : source.values) {
+                        AddToBitmap(container, low);
+                    }
+                }
+                continue;
+            }
+
+            merge_buffer_.clear();
+            std::set_union(container.values.begin(), container.values.end(), source.values.begin(), source.values.end(),
+                           std::back_inserter(merge_buffer_));
+            container.values.swap(merge_buffer_);
+
+            if (container.values.size() > MAX_ARRAY_SIZE) {
+                ConvertToBitmap(container);
+            }
+        }
+
+        return *this;
+    }
+
+    bool IsEmpty() const {
+        return container_count_ == 0u;
+    }
+
+    size_t GetCardinality() const {
+        size_t cardinality = 0;
+
+        for (size_t i = 0; i < container_count_; ++i) {
+            const Container& container = containers_[i];
+            cardinality += container.is_bitmap ? container.cardinality : container.values.size();
+        }
+
+        return cardinality;
+    }
+
+    void Clear() {
+        for (size_t i = 0; i < container_count_; ++i) {
+            containers_[i].values.clear();
+            containers_[i].is_bitmap = false;
+        }
+
+        container_count_ = 0;
+    }
+
+   private:
+    // an array of more values takes more space than a bitmap
+    static const size_t MAX_ARRAY_SIZE = 4096;
+    static const size_t BITMAP_WORD_COUNT = (1 << 16) / 64;
+
+    struct Container {
+        uint16_t key = 0;
+        bool is_bitmap = false;
+        uint32_t cardinality = 0;  // of a bitmap
+        std::vector<uint16_t> values;
+        std::vector<uint64_t> words;
+    };
+
+    // containers_[0, container_count_) are used and sorted by key, the rest keep their memory for reuse
+    std::vector<Container> containers_;
+    size_t container_count_ = 0;
+    std::vector<uint16_t> merge_buffer_;
+
+    const Container* FindContainer(uint16_t key) const {
+        const auto end = containers_.begin() + container_count_;
+        const auto container = std::lower_bound(containers_.begin(), end, key, [](const Container& lhs, uint16_t key) {
+            return lhs.key < key;
+        });
+
+        return container != end && container->key == key ? &*container : nullptr;
+    }
+
+    Container& GetOrInsertContainer(uint16_t key) {
+        // values usually come sorted, so the last container is the one
+        if (container_count_ > 0u && containers_[container_count_ - 1].key == key) {
+            return containers_[container_count_ - 1];
+        }
+
+        const auto end = containers_.begin() + container_count_;
+        const auto position = std::lower_bound(containers_.begin(), end, key, [](const Container& lhs, uint16_t key) {
+            return lhs.key < key;
+        });
+        if (position != end && position->key == key) {
+            return *position;
+        }
+
+        const size_t index = position - containers_.begin();
+        if (container_count_ == containers_.size()) {
+            containers_.emplace_back();
+        }
+
+        // the first unused container moves to its place, the following ones shift right
+        std::rotate(containers_.begin() + index, containers_.begin() + container_count_,
+                    containers_.begin() + container_count_ + 1);
+        ++container_count_;
+
+        Container& container = containers_[index];
+        container.key = key;
+
+        return container;
+    }
+
+    static void AddToBitmap(Container& container, uint16_t low) {
+        uint64_t& word = container.words[low / 64];
+        const uint64_t bit = uint64_t{1} << (low % 64);
+
+        container.cardinality += (word & bit) == 0u ? 1 : 0;
+        word |= bit;
+    }
+
+    static void ConvertToBitmap(Container& container) {
+        container.words.assign(BITMAP_WORD_COUNT, 0u);
+        container.cardinality = 0;
+        container.is_bitmap = true;
+
+        for (const uint16_t low : container.values) {
+            AddToBitmap(container, low);
+        }
+        container.values.clear();
+    }
+
+    static uint32_t CountBits(const std::vector<uint64_t>& words) {
+        uint32_t count = 0;
+
+        for (uint64_t word : words) {
+            while (word != 0u) {
+                word &= word - 1;
+                ++count;
+            }
+        }
+
+        return count;
+    }
+};
@@ -0,0 +1,66 @@
+#include <atomic>
+#include <future>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "../../run_test.h"
+#include "../thread_pool.h"
+
+using namespace std;
+
+void TestResults() {
+    ThreadPool pool(4);
+    ASSERT_EQUAL(pool.GetThreadCount(), 4u);
+
+    vector<future<int>> results;
+    for (int i = 0; i < 1000; ++i) {
+        results.push_back(pool.Submit([i]() {
+            return i * i;
+        }));
+    }
+
+    for (int i = 0; i < 1000; ++i) {
+        ASSERT_EQUAL(results[i].get(), i * i);
+    }
+}
+
+void TestExceptions() {
+    ThreadPool pool(2);
+
+    future<void> failed = pool.Submit([]() {
+        throw invalid_argument("task failed"s);
+    });
+    future<string> succeeded = pool.Submit([]() {
+        return "ok"s;
+    });
+
+    try {
+        failed.get();
+        ASSERT(false);
+    } catch (const invalid_argument&) {
+    }
+    ASSERT_EQUAL(succeeded.get(), "ok"s);
+}
+
+void TestQueuedTasksFinishOnDestruction() {
+    atomic_int finished_count = 0;
+
+    {
+        ThreadPool pool(3);
+        for (int i = 0; i < 500; ++i) {
+            pool.Submit([&finished_count]() {
+                ++finished_count;
+            });
+        }
+    }
+
+    ASSERT_EQUAL(finished_count.load(), 500);
+}
+
+int main() {
+    RUN_TEST(TestResults);
+    RUN_TEST(TestExceptions);
+    RUN_TEST(TestQueuedTasksFinishOnDestruction);
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Fixed set of threads taking tasks from a common queue. Submit returns a future of the task's
+// result, and an exception thrown by the task is rethrown by the future's get. Queued tasks are
+// finished before the destructor returns
+class ThreadPool {
+   public:
+    explicit ThreadPool(size_t thread_count) {
+        threads_.reserve(thread_count);
+
+        for (size_t i = 0; i < thread_count; ++i) {
+            threads_.emplace_back([this]() {
+                RunTasks();
+            });
+        }
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            is_stopping_ = true;
+        }
+
+        condition_.notify_all();
+        for (std::thread& thread : threads_) {
+            thread.join();
+        }
+    }
+
+    template <typename Task>
+    std::future<std::invoke_result_t<Task>> Submit(Task task) {
+        // std::function has to be copyable, so the move-only packaged task is shared
+        auto packaged_task = std::make_shared<std::packaged_task<std::invoke_result_t<Task>()>>(std::move(task));
+        std::future<std::invoke_result_t<Task>> result = packaged_task->get_future();
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            tasks_.emplace_back([packaged_task]() {
+                (*packaged_task)();
+            });
+        }
+        condition_.notify_one();
+
+        return result;
+    }
+
+    size_t GetThreadCount() const {
+        return threads_.size();
+    }
+
+   private:
+    std::mutex mutex_;
+    std::condition_variable condition_;
+    std::deque<std::function<void()>> tasks_;
+    bool is_stopping_ = false;
+    std::vector<std::thread> threads_;
+
+    void RunTasks() {
+        while (true) {
+            std::function<void()> task;
+
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                condition_.wait(lock, [this]() {
+                    return is_stopping_ || !tasks_.empty();
+                });
+
+                if (tasks_.empty()) {
+                    return;
+                }
+
+                task = std::move(tasks_.front());
+                tasks_.pop_front();
+            }
+
+            task();
+        }
+    }
+};
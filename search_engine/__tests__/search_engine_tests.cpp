@@ -1,22 +1,74 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <cmath>
+#include <cstdlib>
+#include <execution>
+#include <filesystem>
+#include <fstream>
 #include <iomanip>
 #include <iostream>
+#include <map>
+#include <new>
+#include <random>
+#include <set>
+#include <sstream>
+#include <stdexcept>
 #include <string>
 #include <string_view>
+#include <thread>
+#include <tuple>
+#include <utility>
 #include <vector>
 
 #include "../../helpers/run_test.h"
+#include "../async_query.h"
 #include "../document.h"
 #include "../paginator.h"
+#include "../posting_list.h"
 #include "../process_queries.h"
+#include "../query_plan.h"
 #include "../remove_duplicates.h"
 #include "../request_queue.h"
+#include "../score_kernel.h"
 #include "../search_server.h"
+#include "../segmented_search_server.h"
+#include "../sharded_search_server.h"
+#include "../string_processing.h"
 #include "../test_example_functions.h"
+#include "../tokenizer.h"
 
 using namespace std::string_literals;
 using namespace std::string_view_literals;
 
+// allocations of the whole test program are counted to check the ones of a query; the operators are
+// kept out of line, otherwise compilers see malloc and free where new and delete are used
+std::atomic<size_t> allocation_count = 0;
+
+[[gnu::noinline]] void* operator new(std::size_t size) {
+    ++allocation_count;
+
+    if (void* memory = std::malloc(size == 0u ? 1u : size)) {
+        return memory;
+    }
+    throw std::bad_alloc();
+}
+
+// temporary buffers of std::stable_sort come from here, and are freed by the usual delete
+[[gnu::noinline]] void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    ++allocation_count;
+
+    return std::malloc(size == 0u ? 1u : size);
+}
+
+[[gnu::noinline]] void operator delete(void* memory) noexcept {
+    std::free(memory);
+}
+
+[[gnu::noinline]] void operator delete(void* memory, std::size_t) noexcept {
+    std::free(memory);
+}
+
 std::ostream& operator<<(std::ostream& os, DocumentStatus doc) {
     const char* status = 0;
 #define PROCESS_DOC(p) \
@@ -163,6 +215,40 @@ void TestMatchingDocument() {
     }
 }
 
+void TestRemovingDocument() {
+    const std::vector<int> ratings = {1, 2, 3};
+
+    {
+        SearchServer server;
+        server.AddDocument(42, "cat in the city"s, DocumentStatus::ACTUAL, ratings);
+        server.AddDocument(43, "dog in the city"s, DocumentStatus::ACTUAL, ratings);
+        server.AddDocument(44, "cat and dog"s, DocumentStatus::ACTUAL, ratings);
+
+        server.RemoveDocument(42);
+        ASSERT_EQUAL(server.GetDocumentCount(), 2);
+        ASSERT(server.GetWordFrequencies(42).empty());
+
+        const auto found_docs = server.FindTopDocuments("cat city"s);
+        ASSERT_EQUAL(found_docs.size(), 2u);
+        ASSERT_EQUAL(found_docs[0].id + found_docs[1].id, 43 + 44);
+
+        // removing an absent document changes nothing
+        server.RemoveDocument(std::execution::par, 42);
+        ASSERT_EQUAL(server.GetDocumentCount(), 2);
+    }
+
+    // words that aren't indexed don't match anything
+    {
+        SearchServer server;
+        server.AddDocument(42, "cat in the city"s, DocumentStatus::ACTUAL, ratings);
+
+        const auto [words, status] = server.MatchDocument("dog city -bird"s, 42);
+        ASSERT_EQUAL(words.size(), 1u);
+        ASSERT_EQUAL(words[0], "city"s);
+        ASSERT(server.FindTopDocuments("dog"s).empty());
+    }
+}
+
 void TestDocumentRelevance() {
     const int doc_id_city = 42;
     const std::string content_city = "cat in the city";
@@ -340,18 +426,1586 @@ void TestProcessQueries() {
     }
 }
 
+std::string GenerateText(std::mt19937& generator, int vocabulary_size, int word_count) {
+    std::uniform_int_distribution<int> word_distribution(0, vocabulary_size - 1);
+    std::string text;
+
+    for (int i = 0; i < word_count; ++i) {
+        text += "w"s + std::to_string(word_distribution(generator)) + " "s;
+    }
+
+    return text;
+}
+
+void TestParallelSearchMatchesSequential() {
+    std::mt19937 generator(42);
+    SearchServer server("w0 w1"sv);
+
+    for (int id = 0; id < 20000; ++id) {
+        server.AddDocument(id, GenerateText(generator, 100, 20), static_cast<DocumentStatus>(id % 4), {id % 7, id % 13});
+    }
+
+    for (int i = 0; i < 20; ++i) {
+        const std::string query = GenerateText(generator, 120, 5) + "-w"s + std::to_string(i);
+        const auto seq_docs = server.FindTopDocuments(std::execution::seq, query, DocumentStatus::BANNED);
+        const auto par_docs = server.FindTopDocuments(std::execution::par, query, DocumentStatus::BANNED);
+
+        ASSERT_EQUAL(seq_docs.size(), par_docs.size());
+        for (size_t j = 0; j < seq_docs.size(); ++j) {
+            ASSERT(std::abs(seq_docs[j].relevance - par_docs[j].relevance) < EPS);
+            ASSERT_EQUAL(seq_docs[j].rating, par_docs[j].rating);
+        }
+    }
+}
+
+// scores every document straight from its word frequencies
+std::vector<Document> FindTopDocumentsExhaustively(const SearchServer& server, const std::vector<int>& ratings,
+                                                   const std::set<std::string>& plus_words, const std::set<std::string>& minus_words) {
+    std::map<std::string, int> document_freqs;
+    for (const int document_id : server) {
+        for (const auto& [word, _] : server.GetWordFrequencies(document_id)) {
+            ++document_freqs[std::string(word)];
+        }
+    }
+
+    std::vector<Document> documents;
+    for (const int document_id : server) {
+        bool is_matched = false;
+        double relevance = 0.0;
+
+        for (const auto& [word_view, term_freq] : server.GetWordFrequencies(document_id)) {
+            const std::string word(word_view);
+
+            if (minus_words.count(word)) {
+                is_matched = false;
+                break;
+            }
+
+            if (plus_words.count(word)) {
+                is_matched = true;
+                relevance += term_freq * std::log(server.GetDocumentCount() * 1.0 / document_freqs.at(word));
+            }
+        }
+
+        if (is_matched) {
+            documents.emplace_back(document_id, relevance, ratings[document_id]);
+        }
+    }
+
+    std::sort(documents.begin(), documents.end(), IsMoreRelevant);
+    if (documents.size() > MAX_RESULT_DOCUMENT_COUNT) {
+        documents.resize(MAX_RESULT_DOCUMENT_COUNT);
+    }
+
+    return documents;
+}
+
+void TestTopDocumentsMatchExhaustiveSearch() {
+    std::mt19937 generator(7);
+    std::uniform_int_distribution<int> length_distribution(1, 12);
+    SearchServer server;
+    std::vector<std::string> texts;
+    std::vector<int> ratings;
+
+    for (int id = 0; id < 3000; ++id) {
+        // repeated texts and few distinct ratings give lots of ties
+        texts.push_back(id % 5 == 4 ? texts[id / 2] : GenerateText(generator, 30, length_distribution(generator)));
+        ratings.push_back(id % 3);
+        server.AddDocument(id, texts.back(), DocumentStatus::ACTUAL, {ratings.back()});
+    }
+    for (int id = 0; id < 3000; id += 11) {
+        server.RemoveDocument(id);
+    }
+
+    for (int i = 0; i < 200; ++i) {
+        std::string query = GenerateText(generator, 35, 1 + i % 4);
+        std::set<std::string> plus_words;
+        for (std::string_view word : SplitIntoWords(query)) {
+            plus_words.insert(std::string(word));
+        }
+
+        std::set<std::string> minus_words;
+        if (i % 3 == 0) {
+            minus_words.insert("w"s + std::to_string(i % 30));
+            query += " -w"s + std::to_string(i % 30);
+        }
+
+        const auto expected = FindTopDocumentsExhaustively(server, ratings, plus_words, minus_words);
+        for (const auto& found_docs : {server.FindTopDocuments(std::execution::seq, query),
+                                       server.FindTopDocuments(std::execution::par, query)}) {
+            ASSERT_EQUAL(found_docs.size(), expected.size());
+            for (size_t j = 0; j < expected.size(); ++j) {
+                ASSERT_EQUAL(found_docs[j].id, expected[j].id);
+                ASSERT(std::abs(found_docs[j].relevance - expected[j].relevance) < EPS);
+            }
+        }
+    }
+}
+
+void TestPostingListCompression() {
+    std::mt19937 generator(3);
+    std::uniform_int_distribution<uint32_t> gap_distribution(1, 40);
+    std::uniform_int_distribution<uint32_t> count_distribution(1, 3);
+    PostingList postings;
+    std::vector<std::pair<uint32_t, uint32_t>> expected;
+
+    uint32_t ordinal = 0;
+    for (int i = 0; i < 100000; ++i) {
+        ordinal += gap_distribution(generator);
+        expected.emplace_back(ordinal, i % 1000 == 0 ? 70000 : count_distribution(generator));
+        postings.Append(ordinal, expected.back().second, 0.5);
+    }
+
+    // a plain posting takes 8 bytes, and a map node more than 48
+    ASSERT(postings.GetMemoryUsage() < 2 * postings.GetSize());
+
+    for (size_t i = 0; i < expected.size(); i += 3) {
+        postings.Erase(expected[i].first);
+    }
+    postings.Erase(ordinal + 1);
+    expected.erase(std::remove_if(expected.begin(), expected.end(), [&](const auto& posting) {
+                       return (&posting - expected.data()) % 3 == 0;
+                   }),
+                   expected.end());
+    ASSERT_EQUAL(postings.GetSize(), expected.size());
+
+    size_t i = 0;
+    for (PostingList::Cursor cursor(postings); !cursor.IsEnd(); cursor.Next(), ++i) {
+        ASSERT_EQUAL(cursor.GetOrdinal(), expected[i].first);
+        ASSERT_EQUAL(cursor.GetTermCount(), expected[i].second);
+    }
+    ASSERT_EQUAL(i, expected.size());
+
+    PostingList::Cursor cursor(postings);
+    cursor.Seek(expected[5000].first - 1);
+    ASSERT_EQUAL(cursor.GetOrdinal(), expected[5000].first);
+    ASSERT(postings.Contains(expected[777].first));
+    ASSERT(!postings.Contains(expected[777].first + 1));
+}
+
+void TestSaveAndOpenIndex() {
+    std::mt19937 generator(5);
+    SearchServer server("and with"s);
+    for (int id = 0; id < 3000; ++id) {
+        server.AddDocument(id * 3, GenerateText(generator, 2000, 30), static_cast<DocumentStatus>(id % 4), {id % 7, -id % 5});
+    }
+    for (int id = 0; id < 3000; id += 11) {
+        server.RemoveDocument(id * 3);
+    }
+
+    const std::string path = (std::filesystem::temp_directory_path() / "search_engine_index_test.bin").string();
+    server.SaveIndex(path);
+    SearchServer opened = SearchServer::OpenIndex(path);
+
+    ASSERT_EQUAL(opened.GetDocumentCount(), server.GetDocumentCount());
+    ASSERT(opened.GetWordFrequencies(3) == server.GetWordFrequencies(3));
+    ASSERT(opened.GetWordFrequencies(0).empty());
+
+    const auto check_same_results = [&](const std::string& query) {
+        const std::vector<Document> expected = server.FindTopDocuments(query, DocumentStatus::BANNED);
+        const std::vector<Document> found = opened.FindTopDocuments(query, DocumentStatus::BANNED);
+
+        ASSERT_EQUAL(found.size(), expected.size());
+        for (size_t i = 0; i < found.size(); ++i) {
+            ASSERT_EQUAL(found[i].id, expected[i].id);
+            ASSERT_EQUAL(found[i].rating, expected[i].rating);
+            ASSERT(std::abs(found[i].relevance - expected[i].relevance) < EPS);
+        }
+    };
+
+    for (int i = 0; i < 50; ++i) {
+        const std::string query = GenerateText(generator, 2000, 3) + " -"s + GenerateText(generator, 2000, 1);
+        check_same_results(query);
+    }
+
+    // an opened index stays writable
+    for (SearchServer* target : {&server, &opened}) {
+        target->AddDocument(100000, "brand new words and stop words"s, DocumentStatus::BANNED, {9});
+        target->RemoveDocument(6);
+    }
+    check_same_results("brand words w1 w2"s);
+    ASSERT_EQUAL(opened.GetDocumentCount(), server.GetDocumentCount());
+
+    // nonsense is rejected instead of being mapped
+    {
+        std::ofstream out(path, std::ios::binary);
+        out << "not an index"s;
+    }
+    try {
+        SearchServer::OpenIndex(path);
+        ASSERT(false);
+    } catch (const std::runtime_error&) {
+    }
+
+    // so is a status out of range: the index of a document ends with its status byte and an empty
+    // array of tombstones, whose size is padded up to 8 bytes
+    {
+        SearchServer single;
+        single.AddDocument(1, "single document"s, DocumentStatus::BANNED, {});
+        single.SaveIndex(path);
+    }
+    {
+        std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+        file.seekg(-16, std::ios::end);
+        ASSERT_EQUAL(file.get(), static_cast<int>(DocumentStatus::BANNED));
+        file.seekp(-16, std::ios::end);
+        file.put(static_cast<char>(DOCUMENT_STATUS_COUNT));
+    }
+    try {
+        SearchServer::OpenIndex(path);
+        ASSERT(false);
+    } catch (const std::runtime_error&) {
+    }
+
+    try {
+        SearchServer().AddDocument(1, "document"s, static_cast<DocumentStatus>(DOCUMENT_STATUS_COUNT), {});
+        ASSERT(false);
+    } catch (const std::invalid_argument&) {
+    }
+
+    std::filesystem::remove(path);
+}
+
+void TestAddingDocumentsInBulk() {
+    std::mt19937 generator(8);
+    std::vector<std::tuple<int, std::string, DocumentStatus, std::vector<int>>> documents;
+    for (int id = 0; id < 5000; ++id) {
+        documents.emplace_back(id * 2, GenerateText(generator, 1000, 25), static_cast<DocumentStatus>(id % 3), std::vector<int>{id % 9, 1});
+    }
+
+    SearchServer expected_server("and with"s);
+    for (const auto& [id, text, status, ratings] : documents) {
+        expected_server.AddDocument(id, text, status, ratings);
+    }
+
+    SearchServer server("and with"s);
+    server.AddDocument(1, "before the batch"s, DocumentStatus::ACTUAL, {});
+    server.AddDocuments(std::execution::par, documents);
+    expected_server.AddDocument(1, "before the batch"s, DocumentStatus::ACTUAL, {});
+
+    ASSERT_EQUAL(server.GetDocumentCount(), expected_server.GetDocumentCount());
+    ASSERT(server.GetWordFrequencies(1234) == expected_server.GetWordFrequencies(1234));
+
+    for (int i = 0; i < 50; ++i) {
+        const std::string query = GenerateText(generator, 1000, 3) + " -"s + GenerateText(generator, 1000, 1);
+        const std::vector<Document> expected = expected_server.FindTopDocuments(query);
+        const std::vector<Document> found = server.FindTopDocuments(query);
+
+        ASSERT_EQUAL(found.size(), expected.size());
+        for (size_t j = 0; j < found.size(); ++j) {
+            ASSERT_EQUAL(found[j].id, expected[j].id);
+            ASSERT(std::abs(found[j].relevance - expected[j].relevance) < EPS);
+        }
+    }
+
+    // an invalid record anywhere in the batch leaves the index as it was
+    const std::vector<std::vector<std::tuple<int, std::string_view, DocumentStatus, std::vector<int>>>> invalid_batches = {
+        {{20000, "fine"sv, DocumentStatus::ACTUAL, {}}, {-1, "negative id"sv, DocumentStatus::ACTUAL, {}}},
+        {{20000, "fine"sv, DocumentStatus::ACTUAL, {}}, {20000, "same id"sv, DocumentStatus::ACTUAL, {}}},
+        {{20000, "fine"sv, DocumentStatus::ACTUAL, {}}, {2, "added id"sv, DocumentStatus::ACTUAL, {}}},
+        {{20000, "fine"sv, DocumentStatus::ACTUAL, {}}, {20001, "special\x12word"sv, DocumentStatus::ACTUAL, {}}},
+    };
+    for (const auto& batch : invalid_batches) {
+        try {
+            server.AddDocuments(std::execution::par, batch);
+            ASSERT(false);
+        } catch (const std::invalid_argument&) {
+        }
+
+        ASSERT_EQUAL(server.GetDocumentCount(), expected_server.GetDocumentCount());
+        ASSERT(server.FindTopDocuments("fine"s).empty());
+    }
+}
+
+void TestTokenizer() {
+    Tokenizer tokenizer;
+    tokenizer.AddStopWord("and"sv);
+    tokenizer.AddStopWord("in"sv);
+
+    std::vector<std::string_view> words;
+    ASSERT(tokenizer.Split("  cat and dog in   the city "sv, true, words).empty());
+    ASSERT(words == std::vector<std::string_view>({"cat"sv, "dog"sv, "the"sv, "city"sv}));
+    ASSERT(tokenizer.Split("cat and dog"sv, false, words).empty());
+    ASSERT_EQUAL(words.size(), 3u);
+    ASSERT(tokenizer.IsStopWord("in"sv) && !tokenizer.IsStopWord("i"sv));
+
+    // texts are scanned by chunks, so words of any length have to cross their boundaries
+    std::mt19937 generator(9);
+    std::uniform_int_distribution<int> char_distribution(0, 5);
+    for (int i = 0; i < 1000; ++i) {
+        std::string text(i % 100, ' ');
+        for (char& c : text) {
+            c = char_distribution(generator) == 0 ? ' ' : static_cast<char>('a' + char_distribution(generator));
+        }
+        text += i % 3 == 0 ? "\xE9t\xE9"s : ""s;
+
+        ASSERT(tokenizer.Split(text, false, words).empty());
+        ASSERT(words == SplitIntoWords(text));
+
+        const size_t position = i % (text.size() + 1);
+        text.insert(position, "\t"s);
+        const std::string_view invalid_word = tokenizer.Split(text, true, words);
+        ASSERT(!invalid_word.empty());
+        ASSERT(invalid_word.find('\t') != invalid_word.npos);
+        ASSERT(invalid_word.find(' ') == invalid_word.npos);
+    }
+}
+
+void TestQueryAllocations() {
+    std::mt19937 generator(10);
+    SearchServer server("and with"s);
+    for (int id = 0; id < 2000; ++id) {
+        server.AddDocument(id, GenerateText(generator, 300, 20), DocumentStatus::ACTUAL, {id % 5});
+    }
+
+    const std::string_view query = "w1 w2 w3 w3 w4 w5 w6 and -w7 -w8"sv;
+    // the first query of the thread grows its buffers
+    const std::vector<Document> expected = server.FindTopDocuments(query);
+    ASSERT_EQUAL(expected.size(), 5u);
+
+    const size_t allocations_before = allocation_count;
+    const std::vector<Document> found = server.FindTopDocuments(query);
+    const size_t allocations = allocation_count - allocations_before;
+
+    // the result is the only allocation
+    ASSERT_EQUAL(allocations, 1u);
+    ASSERT_EQUAL(found.size(), expected.size());
+    ASSERT_EQUAL(found.front().id, expected.front().id);
+
+    // a query from a comparator of another one gets its own buffers
+    const std::vector<Document> nested = server.FindTopDocuments(query, [&](int document_id, DocumentStatus, int) {
+        return server.FindTopDocuments("w9"sv).front().id != document_id;
+    });
+    ASSERT_EQUAL(nested.size(), 5u);
+}
+
+void TestFilteringByStatusBitmaps() {
+    std::mt19937 generator(11);
+    SearchServer server("and with"s);
+    for (int id = 0; id < 3000; ++id) {
+        server.AddDocument(id, GenerateText(generator, 200, 15), static_cast<DocumentStatus>(id % 4), {id % 7});
+    }
+    for (int id = 0; id < 3000; id += 5) {
+        server.RemoveDocument(id);
+    }
+
+    for (int i = 0; i < 40; ++i) {
+        const std::string query = GenerateText(generator, 200, 3);
+        const DocumentStatus status = static_cast<DocumentStatus>(i % 4);
+
+        const std::vector<Document> expected = server.FindTopDocuments(query, [status](int, DocumentStatus document_status, int) {
+            return document_status == status;
+        });
+        for (const std::vector<Document>& found : {server.FindTopDocuments(query, status),
+                                                   server.FindTopDocuments(std::execution::par, query, status)}) {
+            ASSERT_EQUAL(found.size(), expected.size());
+            for (size_t j = 0; j < found.size(); ++j) {
+                ASSERT_EQUAL(found[j].id, expected[j].id);
+                ASSERT_EQUAL(found[j].status, status);
+                ASSERT(found[j].id % 5 != 0);
+            }
+        }
+    }
+}
+
+void TestIndexedComparators() {
+    std::mt19937 generator(12);
+    SearchServer server("and with"s);
+    for (int id = 0; id < 3000; ++id) {
+        server.AddDocument(id, GenerateText(generator, 200, 15), static_cast<DocumentStatus>(id % 4), {id % 11});
+    }
+
+    for (int i = 0; i < 40; ++i) {
+        const std::string query = GenerateText(generator, 200, 4);
+        const int min_rating = i % 11;
+
+        const std::vector<Document> expected = server.FindTopDocuments(query, [min_rating](int, DocumentStatus, int rating) {
+            return rating >= min_rating;
+        });
+        for (const std::vector<Document>& found : {server.FindTopDocuments(query, ByMinRating{min_rating}),
+                                                   server.FindTopDocuments(std::execution::par, query, ByMinRating{min_rating})}) {
+            ASSERT_EQUAL(found.size(), expected.size());
+            for (size_t j = 0; j < found.size(); ++j) {
+                ASSERT_EQUAL(found[j].id, expected[j].id);
+            }
+        }
+
+        const std::vector<Document> by_status = server.FindTopDocuments(query, ByStatus{DocumentStatus::BANNED});
+        const std::vector<Document> by_status_lambda = server.FindTopDocuments(query, [](int, DocumentStatus status, int) {
+            return status == DocumentStatus::BANNED;
+        });
+        ASSERT_EQUAL(by_status.size(), by_status_lambda.size());
+        for (size_t j = 0; j < by_status.size(); ++j) {
+            ASSERT_EQUAL(by_status[j].id, by_status_lambda[j].id);
+        }
+    }
+
+    // a document matching several terms of a query is checked once
+    std::map<int, int> call_counts;
+    server.FindTopDocuments("w1 w2 w3 w4 w5 w6 w7 w8"s, [&call_counts](int document_id, DocumentStatus, int) {
+        ++call_counts[document_id];
+        return document_id % 2 == 0;
+    });
+    ASSERT(!call_counts.empty());
+    for (const auto& [document_id, call_count] : call_counts) {
+        ASSERT_EQUAL(call_count, 1);
+    }
+}
+
+void TestMinusWordsExclusion() {
+    std::mt19937 generator(13);
+    SearchServer server("and with"s);
+    // a small vocabulary makes minus words exclude about a half of all the documents each
+    for (int id = 0; id < 5000; ++id) {
+        server.AddDocument(id, GenerateText(generator, 30, 20), static_cast<DocumentStatus>(id % 2), {id % 9});
+    }
+
+    for (int i = 0; i < 20; ++i) {
+        const std::string plus_words = GenerateText(generator, 30, 3);
+        const std::string minus_word_a = "w"s + std::to_string(i % 30);
+        const std::string minus_word_b = "w"s + std::to_string((i * 7 + 3) % 30);
+        const std::string query = plus_words + " -"s + minus_word_a + " -"s + minus_word_b;
+
+        const std::vector<Document> expected = server.FindTopDocuments(plus_words, [&](int document_id, DocumentStatus status, int) {
+            const std::map<std::string_view, double> word_frequencies = server.GetWordFrequencies(document_id);
+            return status == DocumentStatus::ACTUAL && word_frequencies.count(minus_word_a) == 0u &&
+                   word_frequencies.count(minus_word_b) == 0u;
+        });
+        ASSERT(!expected.empty());
+
+        for (const std::vector<Document>& found : {server.FindTopDocuments(query),
+                                                   server.FindTopDocuments(std::execution::par, query)}) {
+            ASSERT_EQUAL(found.size(), expected.size());
+            for (size_t j = 0; j < found.size(); ++j) {
+                ASSERT_EQUAL(found[j].id, expected[j].id);
+                ASSERT(std::abs(found[j].relevance - expected[j].relevance) < EPS);
+            }
+        }
+    }
+
+    // every found document has a minus word
+    ASSERT(server.FindTopDocuments("w1 w2 -w1 -w2"s).empty());
+}
+
+void TestQueryPlanner() {
+    SearchServer server("and with"s);
+    std::vector<int> ratings;
+    for (int id = 0; id < 1000; ++id) {
+        std::string text = "common w"s + std::to_string(id % 10) + " w"s + std::to_string(id / 10 % 10) + " x"s + std::to_string(id % 7);
+        text += id % 100 == 0 ? " rare"s : ""s;
+        text += id % 4 == 0 ? " medium"s : ""s;
+
+        ratings.push_back(id % 5);
+        server.AddDocument(id, text, DocumentStatus::ACTUAL, {ratings.back()});
+    }
+
+    {
+        const QueryPlan plan = server.ExplainQuery("common medium and absent rare -nothing"s);
+        ASSERT_EQUAL(plan.plus_terms.size(), 3u);
+        ASSERT_EQUAL(plan.plus_terms[0].word, "rare"s);
+        ASSERT_EQUAL(plan.plus_terms[0].posting_count, 10u);
+        ASSERT_EQUAL(plan.plus_terms[1].word, "medium"s);
+        ASSERT_EQUAL(plan.plus_terms[2].word, "common"s);
+        ASSERT(plan.minus_terms.empty());
+        ASSERT_EQUAL(plan.skipped_words.size(), 2u);
+        ASSERT(plan.exclusion == ExclusionStrategy::NONE);
+        ASSERT(plan.estimated_cost > 0.0);
+    }
+
+    // one term is pruned best, many similar ones are summed up best
+    ASSERT(server.ExplainQuery("rare"s).scoring == ScoringStrategy::DOCUMENT_AT_A_TIME);
+    const std::string similar_terms = "w0 w1 w2 w3 w4 w5 w6 w7 w8 w9"s;
+    ASSERT(server.ExplainQuery(similar_terms).scoring == ScoringStrategy::TERM_AT_A_TIME);
+
+    // a selective minus word is collected before scoring, a broad one is looked up for few candidates
+    ASSERT(server.ExplainQuery("common -rare"s).exclusion == ExclusionStrategy::BEFORE_SCORING);
+    ASSERT(server.ExplainQuery("rare -x1"s).exclusion == ExclusionStrategy::CANDIDATE_LOOKUP);
+
+    const std::vector<std::tuple<std::string, std::set<std::string>, std::set<std::string>>> queries = {
+        {similar_terms, {"w0"s, "w1"s, "w2"s, "w3"s, "w4"s, "w5"s, "w6"s, "w7"s, "w8"s, "w9"s}, {}},
+        {similar_terms + " -x3"s, {"w0"s, "w1"s, "w2"s, "w3"s, "w4"s, "w5"s, "w6"s, "w7"s, "w8"s, "w9"s}, {"x3"s}},
+        {"common -rare"s, {"common"s}, {"rare"s}},
+        {"rare medium -x1"s, {"rare"s, "medium"s}, {"x1"s}},
+    };
+    for (const auto& [query, plus_words, minus_words] : queries) {
+        const std::vector<Document> expected = FindTopDocumentsExhaustively(server, ratings, plus_words, minus_words);
+        const std::vector<Document> found = server.FindTopDocuments(query);
+
+        ASSERT_EQUAL(found.size(), expected.size());
+        for (size_t j = 0; j < found.size(); ++j) {
+            ASSERT_EQUAL(found[j].id, expected[j].id);
+            ASSERT(std::abs(found[j].relevance - expected[j].relevance) < EPS);
+        }
+    }
+
+    std::ostringstream output;
+    output << server.ExplainQuery(similar_terms + " -x3"s);
+    ASSERT(output.str().find("scoring: term-at-a-time"s) != std::string::npos);
+    ASSERT(output.str().find("minus: x3 ("s) != std::string::npos);
+}
+
+void TestMatchingDocumentsInBatch() {
+    std::mt19937 generator(14);
+    SearchServer server("and with"s);
+    std::vector<int> document_ids;
+    for (int id = 0; id < 2000; ++id) {
+        // some documents are much longer than a query, some are shorter
+        server.AddDocument(id, GenerateText(generator, 400, id % 3 == 0 ? 300 : 3), static_cast<DocumentStatus>(id % 4), {});
+        document_ids.push_back(id);
+    }
+    std::shuffle(document_ids.begin(), document_ids.end(), generator);
+
+    for (int i = 0; i < 20; ++i) {
+        const std::string query = GenerateText(generator, 400, 1 + i % 12) + (i % 2 == 0 ? " -w"s + std::to_string(i) : ""s);
+        const auto matches = server.MatchDocuments(query, document_ids);
+        ASSERT_EQUAL(matches.size(), document_ids.size());
+
+        std::set<std::string> plus_words;
+        for (std::string_view word : SplitIntoWords(query)) {
+            if (word[0] != '-') {
+                plus_words.insert(std::string(word));
+            }
+        }
+
+        for (size_t j = 0; j < document_ids.size(); ++j) {
+            const int document_id = document_ids[j];
+            const auto& [words, status] = matches[j];
+            ASSERT_EQUAL(status, static_cast<DocumentStatus>(document_id % 4));
+
+            const std::map<std::string_view, double> word_frequencies = server.GetWordFrequencies(document_id);
+            std::vector<std::string_view> expected;
+            if (i % 2 != 0 || word_frequencies.count("w"s + std::to_string(i)) == 0u) {
+                for (const std::string& word : plus_words) {
+                    if (word_frequencies.count(word)) {
+                        expected.push_back(word_frequencies.find(word)->first);
+                    }
+                }
+            }
+
+            ASSERT(words == expected);
+            ASSERT(std::get<0>(server.MatchDocument(std::execution::par, query, document_id)) == expected);
+        }
+
+        ASSERT(server.MatchDocuments(std::execution::par, query, document_ids) == matches);
+    }
+
+    try {
+        server.MatchDocuments("w1"s, {1, 2, 5000});
+        ASSERT(false);
+    } catch (const std::out_of_range&) {
+    }
+    ASSERT(server.MatchDocuments("w1"s, {}).empty());
+}
+
+void TestShardedSearchServer() {
+    std::mt19937 generator(15);
+    SearchServer expected_server("and with"s);
+    ShardedSearchServer server("and with"s, 4);
+    ASSERT_EQUAL(server.GetShardCount(), 4u);
+
+    for (int id = 0; id < 3000; ++id) {
+        const std::string text = GenerateText(generator, 500, 20);
+        const DocumentStatus status = static_cast<DocumentStatus>(id % 3);
+
+        expected_server.AddDocument(id, text, status, {id % 10});
+        server.AddDocument(id, text, status, {id % 10});
+    }
+    for (int id = 0; id < 3000; id += 7) {
+        expected_server.RemoveDocument(id);
+        server.RemoveDocument(id);
+    }
+    ASSERT_EQUAL(server.GetDocumentCount(), expected_server.GetDocumentCount());
+
+    try {
+        server.AddDocument(1, "again"s, DocumentStatus::ACTUAL, {});
+        ASSERT(false);
+    } catch (const std::invalid_argument&) {
+    }
+    try {
+        server.FindTopDocuments("w1 --w2"s);
+        ASSERT(false);
+    } catch (const std::invalid_argument&) {
+    }
+
+    const auto check_same = [](const std::vector<Document>& found, const std::vector<Document>& expected) {
+        ASSERT_EQUAL(found.size(), expected.size());
+        for (size_t j = 0; j < found.size(); ++j) {
+            ASSERT_EQUAL(found[j].id, expected[j].id);
+            ASSERT(std::abs(found[j].relevance - expected[j].relevance) < EPS);
+        }
+    };
+
+    for (int i = 0; i < 50; ++i) {
+        const std::string query = GenerateText(generator, 500, 1 + i % 5) + " -"s + GenerateText(generator, 500, 1);
+
+        check_same(server.FindTopDocuments(query), expected_server.FindTopDocuments(query));
+        check_same(server.FindTopDocuments(std::execution::seq, query, DocumentStatus::BANNED),
+                   expected_server.FindTopDocuments(query, DocumentStatus::BANNED));
+
+        const auto is_even = [](int document_id, DocumentStatus, int) {
+            return document_id % 2 == 0;
+        };
+        check_same(server.FindTopDocuments(query, is_even), expected_server.FindTopDocuments(query, is_even));
+
+        const int document_id = 1 + i * 42;
+        ASSERT(std::get<0>(server.MatchDocument(query, document_id)) == std::get<0>(expected_server.MatchDocument(query, document_id)));
+    }
+}
+
+void TestProcessQueriesInBatch() {
+    std::mt19937 generator(16);
+    SearchServer server("and with"s);
+    for (int id = 0; id < 4000; ++id) {
+        server.AddDocument(id, GenerateText(generator, 300, 15), static_cast<DocumentStatus>(id % 3), {id % 6});
+    }
+
+    // a small vocabulary makes queries share terms, a few don't share any
+    std::vector<std::string> queries;
+    for (int i = 0; i < 300; ++i) {
+        std::string query = GenerateText(generator, i % 10 == 0 ? 300 : 40, 1 + i % 6);
+        query += i % 4 == 0 ? " -w"s + std::to_string(i % 40) : ""s;
+        query += i % 25 == 0 ? " and absent"s : ""s;
+        queries.push_back(query);
+    }
+    queries.push_back("and"s);
+    // repeats of a query in another order and with stop words
+    queries.push_back("w1 w2 -w3"s);
+    queries.push_back("w2 and -w3 w1 w2"s);
+
+    const std::vector<std::vector<Document>> found = ProcessQueries(server, queries);
+    ASSERT_EQUAL(found.size(), queries.size());
+
+    for (size_t i = 0; i < queries.size(); ++i) {
+        const std::vector<Document> expected = server.FindTopDocuments(queries[i]);
+
+        ASSERT_EQUAL(found[i].size(), expected.size());
+        for (size_t j = 0; j < expected.size(); ++j) {
+            ASSERT_EQUAL(found[i][j].id, expected[j].id);
+            ASSERT(std::abs(found[i][j].relevance - expected[j].relevance) < EPS);
+        }
+    }
+    ASSERT(found[queries.size() - 3].empty());
+    ASSERT(!found.back().empty());
+
+    try {
+        ProcessQueries(server, {"w1"s, "w2 --w3"s});
+        ASSERT(false);
+    } catch (const std::invalid_argument&) {
+    }
+}
+
+void TestProcessQueriesStreaming() {
+    std::mt19937 generator(17);
+    SearchServer server("and with"s);
+    for (int id = 0; id < 2000; ++id) {
+        server.AddDocument(id, GenerateText(generator, 200, 12), DocumentStatus::ACTUAL, {id % 5});
+    }
+
+    std::vector<std::string> queries;
+    for (int i = 0; i < 500; ++i) {
+        queries.push_back(GenerateText(generator, 200, 1 + i % 4) + (i % 3 == 0 ? " -w7"s : ""s));
+    }
+
+    const size_t worker_count = 3;
+    for (const ResultOrder order : {ResultOrder::AS_QUERIED, ResultOrder::AS_FOUND}) {
+        // queries are generated on the fly, and no more of them are taken than the workers may have
+        size_t taken_count = 0;
+        size_t given_count = 0;
+        std::vector<bool> is_given(queries.size(), false);
+
+        ProcessQueriesStreaming(
+            server,
+            [&](std::string& query) {
+                if (taken_count == queries.size()) {
+                    return false;
+                }
+
+                query = queries[taken_count++];
+                ASSERT(taken_count - given_count <= worker_count * QUERIES_IN_FLIGHT_PER_WORKER);
+                return true;
+            },
+            [&](size_t query_index, std::vector<Document> documents) {
+                if (order == ResultOrder::AS_QUERIED) {
+                    ASSERT_EQUAL(query_index, given_count);
+                }
+                ASSERT(!is_given[query_index]);
+                is_given[query_index] = true;
+                ++given_count;
+
+                const std::vector<Document> expected = server.FindTopDocuments(queries[query_index]);
+                ASSERT_EQUAL(documents.size(), expected.size());
+                for (size_t i = 0; i < expected.size(); ++i) {
+                    ASSERT_EQUAL(documents[i].id, expected[i].id);
+                }
+            },
+            order, worker_count);
+
+        ASSERT_EQUAL(given_count, queries.size());
+    }
+
+    // the results before an invalid query are all given, and its exception leaves
+    {
+        std::vector<std::string> invalid_queries(queries.begin(), queries.begin() + 20);
+        invalid_queries[12] = "w1 --w2"s;
+        std::vector<size_t> given_indexes;
+
+        try {
+            ProcessQueriesStreaming(server, invalid_queries.begin(), invalid_queries.end(), [&](size_t query_index, std::vector<Document>) {
+                given_indexes.push_back(query_index);
+            });
+            ASSERT(false);
+        } catch (const std::invalid_argument&) {
+        }
+
+        ASSERT_EQUAL(given_indexes.size(), 12u);
+        ASSERT_EQUAL(given_indexes.back(), 11u);
+    }
+
+    // an exception of the callback leaves too
+    try {
+        ProcessQueriesStreaming(server, queries.begin(), queries.end(), [](size_t query_index, std::vector<Document>) {
+            if (query_index == 30) {
+                throw std::runtime_error("stop"s);
+            }
+        });
+        ASSERT(false);
+    } catch (const std::runtime_error&) {
+    }
+}
+
+void TestFindTopDocumentsAsync() {
+    using namespace std::chrono_literals;
+
+    std::mt19937 generator(18);
+    SearchServer server("and with"s);
+    for (int id = 0; id < 20000; ++id) {
+        server.AddDocument(id, GenerateText(generator, 50, 10), DocumentStatus::ACTUAL, {id % 7});
+    }
+    const auto far_deadline = std::chrono::steady_clock::now() + 1h;
+    QueryExecutor executor(2, 4);
+
+    {
+        QueryHandle handle = server.FindTopDocumentsAsync(executor, "w1 w2 -w3"s, far_deadline);
+        ASSERT(handle.WaitUntil(far_deadline));
+        const AsyncQueryResult result = handle.Get();
+        const std::vector<Document> expected = server.FindTopDocuments("w1 w2 -w3"s);
+
+        ASSERT(result.status == QueryStatus::COMPLETE);
+        ASSERT_EQUAL(result.documents.size(), expected.size());
+        for (size_t i = 0; i < expected.size(); ++i) {
+            ASSERT_EQUAL(result.documents[i].id, expected[i].id);
+        }
+        ASSERT_EQUAL(server.FindTopDocumentsAsync("w1 w2 -w3"s, far_deadline).Get().documents.size(), expected.size());
+    }
+
+    // a query past its deadline isn't started
+    {
+        const AsyncQueryResult result = server.FindTopDocumentsAsync(executor, "w1"s, std::chrono::steady_clock::now() - 1s).Get();
+        ASSERT(result.status == QueryStatus::DEADLINE_EXCEEDED);
+        ASSERT(result.documents.empty());
+    }
+
+    // the query is cancelled while documents are scored, the ones scored by then are the result
+    {
+        std::atomic_int call_count = 0;
+        std::atomic_bool is_started = false;
+        std::atomic_bool is_released = false;
+        const auto blocking_comparator = [&call_count, &is_started, &is_released](int, DocumentStatus, int) {
+            if (++call_count == 100) {
+                is_started = true;
+                while (!is_released) {
+                    std::this_thread::yield();
+                }
+            }
+            return true;
+        };
+
+        QueryHandle handle = server.FindTopDocumentsAsync(executor, "w1 w2 w3 w4"s, blocking_comparator, far_deadline);
+        while (!is_started) {
+            std::this_thread::yield();
+        }
+        handle.Cancel();
+        is_released = true;
+
+        const AsyncQueryResult result = handle.Get();
+        ASSERT(result.status == QueryStatus::CANCELLED);
+        ASSERT_EQUAL(result.documents.size(), static_cast<size_t>(MAX_RESULT_DOCUMENT_COUNT));
+        ASSERT(call_count < 1000);
+    }
+
+    // the deadline comes while documents are scored; an executor which starts the query only after
+    // the deadline doesn't score anything, so only the status is certain
+    {
+        const auto deadline = std::chrono::steady_clock::now() + 50ms;
+        std::atomic_int call_count = 0;
+        const auto slow_comparator = [&call_count, deadline](int, DocumentStatus, int) {
+            if (++call_count == 100) {
+                std::this_thread::sleep_until(deadline + 1ms);
+            }
+            return true;
+        };
+
+        const AsyncQueryResult result = server.FindTopDocumentsAsync(executor, "w1 w2 w3 w4"s, slow_comparator, deadline).Get();
+        ASSERT(result.status == QueryStatus::DEADLINE_EXCEEDED);
+        ASSERT(result.documents.size() <= static_cast<size_t>(MAX_RESULT_DOCUMENT_COUNT));
+        ASSERT(call_count < 1000);
+    }
+
+    // an executor taking a single query rejects the others until it's done
+    {
+        QueryExecutor single_executor(1, 1);
+        std::atomic_bool is_started = false;
+        std::atomic_bool is_released = false;
+        const auto waiting_comparator = [&is_started, &is_released](int, DocumentStatus, int) {
+            is_started = true;
+            while (!is_released) {
+                std::this_thread::yield();
+            }
+            return true;
+        };
+
+        QueryHandle handle = server.FindTopDocumentsAsync(single_executor, "w1 w2"s, waiting_comparator, far_deadline);
+        while (!is_started) {
+            std::this_thread::yield();
+        }
+
+        QueryHandle rejected_handle = server.FindTopDocumentsAsync(single_executor, "w1"s, far_deadline);
+        ASSERT(rejected_handle.IsReady());
+        ASSERT(rejected_handle.Get().status == QueryStatus::REJECTED);
+        ASSERT(!handle.IsReady());
+
+        handle.Cancel();
+        is_released = true;
+        const AsyncQueryResult result = handle.Get();
+        ASSERT(result.status == QueryStatus::CANCELLED);
+        ASSERT(!result.documents.empty());
+
+        ASSERT_EQUAL(single_executor.GetAdmittedCount(), 0u);
+        ASSERT(server.FindTopDocumentsAsync(single_executor, "w1"s, far_deadline).Get().status == QueryStatus::COMPLETE);
+    }
+
+    try {
+        server.FindTopDocumentsAsync(executor, "w1 --w2"s, far_deadline).Get();
+        ASSERT(false);
+    } catch (const std::invalid_argument&) {
+    }
+}
+
+void TestQueryCache() {
+    SearchServer server("and with"s);
+    server.AddDocument(1, "white cat and fancy collar"s, DocumentStatus::ACTUAL, {8, -3});
+    server.AddDocument(2, "fluffy cat fluffy tail"s, DocumentStatus::ACTUAL, {7, 2, 7});
+    server.AddDocument(3, "groomed dog expressive eyes"s, DocumentStatus::BANNED, {5, -12, 2, 1});
+
+    server.FindTopDocuments("fluffy cat"s);
+    ASSERT_EQUAL(server.GetQueryCacheStatistics().miss_count, 0u);
+
+    server.EnableQueryCache(1 << 20);
+    const std::vector<Document> found = server.FindTopDocuments("fluffy cat -dog"s);
+    ASSERT_EQUAL(server.GetQueryCacheStatistics().miss_count, 1u);
+
+    // the same query up to word order, repeats, stop words and words absent from the index
+    const std::vector<Document> cached = server.FindTopDocuments("cat and fluffy -dog cat absent"s);
+    QueryCacheStatistics statistics = server.GetQueryCacheStatistics();
+    ASSERT_EQUAL(statistics.hit_count, 1u);
+    ASSERT_EQUAL(statistics.entry_count, 1u);
+    ASSERT(statistics.byte_count > 0);
+    ASSERT(std::abs(statistics.GetHitRatio() - 0.5) < EPS);
+    ASSERT_EQUAL(cached.size(), found.size());
+    for (size_t i = 0; i < found.size(); ++i) {
+        ASSERT_EQUAL(cached[i].id, found[i].id);
+    }
+
+    // another filter is another query, and a comparator of the caller's isn't cached
+    ASSERT_EQUAL(server.FindTopDocuments("fluffy cat -dog"s, DocumentStatus::BANNED).size(), 0u);
+    ASSERT_EQUAL(server.FindTopDocuments("fluffy cat -dog"s, ByMinRating{0}).size(), 2u);
+    server.FindTopDocuments("fluffy cat -dog"s, [](int, DocumentStatus, int) {
+        return true;
+    });
+    statistics = server.GetQueryCacheStatistics();
+    ASSERT_EQUAL(statistics.hit_count, 1u);
+    ASSERT_EQUAL(statistics.miss_count, 3u);
+
+    // adding or removing a document makes cached results stale
+    server.AddDocument(4, "fluffy fluffy cat"s, DocumentStatus::ACTUAL, {1});
+    ASSERT_EQUAL(server.FindTopDocuments("fluffy cat -dog"s).size(), 3u);
+    server.RemoveDocument(4);
+    ASSERT_EQUAL(server.FindTopDocuments("fluffy cat -dog"s).size(), 2u);
+    ASSERT_EQUAL(server.FindTopDocuments("fluffy cat -dog"s).size(), 2u);
+    statistics = server.GetQueryCacheStatistics();
+    ASSERT_EQUAL(statistics.hit_count, 2u);
+    ASSERT_EQUAL(statistics.miss_count, 5u);
+
+    // a cache too small for any result keeps nothing
+    server.EnableQueryCache(0);
+    server.FindTopDocuments("fluffy cat"s);
+    server.FindTopDocuments("fluffy cat"s);
+    statistics = server.GetQueryCacheStatistics();
+    ASSERT_EQUAL(statistics.hit_count, 0u);
+    ASSERT_EQUAL(statistics.miss_count, 2u);
+    ASSERT_EQUAL(statistics.entry_count, 0u);
+
+    // copies don't share results: after a removal each, both are in the same epoch with other documents
+    server.EnableQueryCache(1 << 20);
+    server.FindTopDocuments("fluffy cat"s);
+    SearchServer copy = server;
+    ASSERT_EQUAL(copy.GetQueryCacheStatistics().entry_count, 0u);
+    server.RemoveDocument(1);
+    copy.RemoveDocument(2);
+    ASSERT_EQUAL(server.FindTopDocuments("fluffy cat"s).size(), 1u);
+    ASSERT_EQUAL(server.FindTopDocuments("fluffy cat"s)[0].id, 2);
+    ASSERT_EQUAL(copy.FindTopDocuments("fluffy cat"s).size(), 1u);
+    ASSERT_EQUAL(copy.FindTopDocuments("fluffy cat"s)[0].id, 1);
+    ASSERT_EQUAL(copy.GetQueryCacheStatistics().hit_count, 1u);
+
+    copy = server;
+    ASSERT_EQUAL(copy.FindTopDocuments("fluffy cat"s)[0].id, 2);
+    ASSERT_EQUAL(copy.GetQueryCacheStatistics().miss_count, 1u);
+}
+
+void TestRemoveDuplicates() {
+    SearchServer server("and with"s);
+    server.AddDocument(1, "funny pet and nasty rat"s, DocumentStatus::ACTUAL, {7, 2, 7});
+    server.AddDocument(2, "funny pet with curly hair"s, DocumentStatus::ACTUAL, {1, 2});
+    server.AddDocument(3, "funny pet with curly hair"s, DocumentStatus::ACTUAL, {1, 2});
+    server.AddDocument(4, "funny pet and curly hair"s, DocumentStatus::ACTUAL, {1, 2});
+    server.AddDocument(5, "funny funny pet and nasty nasty rat"s, DocumentStatus::ACTUAL, {1, 2});
+    server.AddDocument(6, "funny pet and not very nasty rat"s, DocumentStatus::ACTUAL, {1, 2});
+    server.AddDocument(7, "very nasty rat and not very funny pet"s, DocumentStatus::ACTUAL, {1, 2});
+    server.AddDocument(8, "pet with rat and rat and rat"s, DocumentStatus::ACTUAL, {1, 2});
+    server.AddDocument(9, "nasty rat with curly hair"s, DocumentStatus::ACTUAL, {1, 2});
+
+    std::ostringstream output;
+    std::streambuf* const cout_buffer = std::cout.rdbuf(output.rdbuf());
+    RemoveDuplicates(server);
+    std::cout.rdbuf(cout_buffer);
+
+    ASSERT_EQUAL(output.str(), "Found duplicate document id 3\n"s
+                               "Found duplicate document id 4\n"s
+                               "Found duplicate document id 5\n"s
+                               "Found duplicate document id 7\n"s);
+    ASSERT_EQUAL(server.GetDocumentCount(), 5);
+    ASSERT(server.FindDuplicates(std::execution::seq).empty());
+
+    // near duplicates differ from a document in a couple of words
+    std::mt19937 generator(20);
+    SearchServer near_server("and with"s);
+    std::vector<std::string> texts;
+    std::set<int> expected_ids;
+    for (int id = 0; id < 3000; ++id) {
+        std::string text = GenerateText(generator, 5000, 60);
+
+        if (id % 10 == 9) {
+            text = texts[id - 1 - generator() % 8] + " w"s + std::to_string(5000 + id);
+            expected_ids.insert(id);
+        }
+
+        texts.push_back(text);
+        near_server.AddDocument(id, text, DocumentStatus::ACTUAL, {1});
+    }
+
+    ASSERT(near_server.FindDuplicates(std::execution::seq).empty());
+    const std::vector<int> duplicate_ids = near_server.FindDuplicates(std::execution::seq, 0.8);
+    ASSERT(std::set<int>(duplicate_ids.begin(), duplicate_ids.end()) == expected_ids);
+    ASSERT(std::is_sorted(duplicate_ids.begin(), duplicate_ids.end()));
+    ASSERT(near_server.FindDuplicates(std::execution::par, 0.8) == duplicate_ids);
+
+    try {
+        near_server.FindDuplicates(std::execution::seq, 0.0);
+        ASSERT(false);
+    } catch (const std::invalid_argument&) {
+    }
+}
+
+void TestSearchCursor() {
+    std::mt19937 generator(21);
+    SearchServer server("and with"s);
+    std::vector<std::string> texts;
+    for (int id = 0; id < 3000; ++id) {
+        // copies of texts tie in relevance, and are ordered by rating and id
+        texts.push_back(id % 10 == 9 ? texts[id - 5] : GenerateText(generator, 400, 12));
+        server.AddDocument(id, texts.back(), DocumentStatus::ACTUAL, {id % 4});
+    }
+
+    for (const std::string& query : {"w1 w2 -w3"s, "w5"s, "w1 w2 w3 w4 w5 w6 w7 w8 w9 w10 -w11"s}) {
+        const std::vector<Document> ranking = server.FindTopDocuments(query, 100000, SearchCursor()).documents;
+        ASSERT(std::is_sorted(ranking.begin(), ranking.end(), IsMoreRelevant));
+
+        const std::vector<Document> top = server.FindTopDocuments(query);
+        ASSERT_EQUAL(top.size(), static_cast<size_t>(MAX_RESULT_DOCUMENT_COUNT));
+        for (size_t i = 0; i < top.size(); ++i) {
+            ASSERT_EQUAL(top[i].id, ranking[i].id);
+        }
+
+        // pages follow each other with the cursor passed around as text
+        std::vector<Document> paged;
+        std::string cursor;
+        while (true) {
+            const SearchPage page = server.FindTopDocuments(query, 7, SearchCursor::FromString(cursor));
+            paged.insert(paged.end(), page.documents.begin(), page.documents.end());
+            cursor = page.next_cursor.ToString();
+
+            if (page.documents.size() < 7) {
+                break;
+            }
+        }
+
+        ASSERT_EQUAL(paged.size(), ranking.size());
+        for (size_t i = 0; i < ranking.size(); ++i) {
+            ASSERT_EQUAL(paged[i].id, ranking[i].id);
+            ASSERT(std::abs(paged[i].relevance - ranking[i].relevance) < EPS);
+        }
+    }
+
+    const SearchPage empty_page = server.FindTopDocuments("absent"s, 10, SearchCursor());
+    ASSERT(empty_page.documents.empty());
+    ASSERT(empty_page.next_cursor.IsStart());
+    ASSERT(SearchCursor().ToString().empty());
+
+    for (const std::string& text : {"1.2"s, "x.1.2"s, "1.2.3.4"s, "1.2.x"s}) {
+        try {
+            SearchCursor::FromString(text);
+            ASSERT(false);
+        } catch (const std::invalid_argument&) {
+        }
+    }
+    try {
+        const size_t page_size = 0;
+        server.FindTopDocuments("w1"s, page_size, SearchCursor());
+        ASSERT(false);
+    } catch (const std::invalid_argument&) {
+    }
+}
+
+void TestPatternQueries() {
+    SearchServer server("and with"s);
+    server.AddDocument(0, "cat and dog"s, DocumentStatus::ACTUAL, {1});
+    server.AddDocument(1, "cats catalog"s, DocumentStatus::ACTUAL, {2});
+    server.AddDocument(2, "car with cot"s, DocumentStatus::ACTUAL, {3});
+    server.AddDocument(3, "act of dog"s, DocumentStatus::ACTUAL, {4});
+    server.AddDocument(4, "catalog catalog cat"s, DocumentStatus::BANNED, {5});
+
+    const auto check_same_results = [](const SearchServer& server, const std::string& pattern_query, const std::string& query) {
+        const std::vector<Document> expected = server.FindTopDocuments(query);
+        const std::vector<Document> found = server.FindTopDocuments(pattern_query);
+
+        ASSERT_EQUAL(found.size(), expected.size());
+        for (size_t i = 0; i < expected.size(); ++i) {
+            ASSERT_EQUAL(found[i].id, expected[i].id);
+            ASSERT(std::abs(found[i].relevance - expected[i].relevance) < EPS);
+        }
+    };
+
+    // a pattern is the same as its terms written out
+    check_same_results(server, "cat*"s, "cat cats catalog"s);
+    check_same_results(server, "c?t"s, "cat cot"s);
+    check_same_results(server, "*at*"s, "cat cats catalog"s);
+    check_same_results(server, "ca* -*log"s, "car cat cats catalog -catalog"s);
+    check_same_results(server, "cat cat* c*t"s, "cat cats catalog cot"s);
+    check_same_results(server, "dog ?x*"s, "dog"s);
+
+    const auto [match_words, status] = server.MatchDocument("c*t* -cow*"s, 1);
+    ASSERT(match_words == std::vector<std::string_view>({"catalog"sv, "cats"sv}));
+    ASSERT(std::get<0>(server.MatchDocument("dog -ca?"s, 0)).empty());
+
+    const QueryPlan plan = server.ExplainQuery("ca? zebra* -x?"s);
+    ASSERT_EQUAL(plan.plus_terms.size(), 2u);
+    ASSERT(plan.skipped_words == std::vector<std::string>({"zebra*"s, "x?"s}));
+    ASSERT_EQUAL(server.GetStatistics("ca?"s).document_freqs.count("car"s), 1u);
+
+    try {
+        server.FindTopDocuments(std::string(100, '?'));
+        ASSERT_HINT(false, "too long pattern must throw"s);
+    } catch (const std::invalid_argument&) {
+    }
+
+    // expansion is bounded by the lexicographically first terms
+    SearchServer big_server;
+    std::vector<std::string> words;
+    for (int id = 0; id < 1000; ++id) {
+        words.push_back("w"s + std::to_string(id));
+        big_server.AddDocument(id, words.back(), DocumentStatus::ACTUAL, {});
+    }
+    std::sort(words.begin(), words.end());
+    words.resize(MAX_PATTERN_TERM_COUNT);
+
+    std::vector<std::string> expanded;
+    for (const PlannedTerm& term : big_server.ExplainQuery("w*"s).plus_terms) {
+        expanded.push_back(term.word);
+    }
+    std::sort(expanded.begin(), expanded.end());
+    ASSERT(expanded == words);
+    ASSERT_EQUAL(big_server.FindTopDocuments("w99?"s).size(), static_cast<size_t>(MAX_RESULT_DOCUMENT_COUNT));
+
+    // the trie is saved with the index and grows after opening
+    const std::string path = (std::filesystem::temp_directory_path() / "search_engine_pattern_test.bin").string();
+    server.SaveIndex(path);
+    SearchServer opened = SearchServer::OpenIndex(path);
+    check_same_results(opened, "cat*"s, "cat cats catalog"s);
+    opened.AddDocument(5, "cab catapult"s, DocumentStatus::ACTUAL, {6});
+    check_same_results(opened, "ca*"s, "cab car cat catalog catapult cats"s);
+    check_same_results(opened, "c?t* -?ab"s, "cat catalog catapult cats cot -cab"s);
+    std::filesystem::remove(path);
+
+    // shards expand patterns to their own terms, statistics are of the whole collection
+    ShardedSearchServer sharded("and with"s, 3);
+    SearchServer single("and with"s);
+    std::mt19937 generator(22);
+    for (int id = 0; id < 2000; ++id) {
+        const std::string text = GenerateText(generator, 3000, 10);
+        sharded.AddDocument(id, text, DocumentStatus::ACTUAL, {id % 5});
+        single.AddDocument(id, text, DocumentStatus::ACTUAL, {id % 5});
+    }
+    for (const std::string& query : {"w12*"s, "w?7 -w1?"s, "w2*5 w1"s}) {
+        const std::vector<Document> expected = single.FindTopDocuments(query);
+        const std::vector<Document> found = sharded.FindTopDocuments(query);
+
+        ASSERT_EQUAL(found.size(), expected.size());
+        for (size_t i = 0; i < expected.size(); ++i) {
+            ASSERT_EQUAL(found[i].id, expected[i].id);
+            ASSERT(std::abs(found[i].relevance - expected[i].relevance) < EPS);
+        }
+    }
+}
+
+int ComputeEditDistance(std::string_view lhs, std::string_view rhs) {
+    std::vector<int> row(rhs.size() + 1);
+    for (size_t j = 0; j <= rhs.size(); ++j) {
+        row[j] = static_cast<int>(j);
+    }
+
+    for (size_t i = 1; i <= lhs.size(); ++i) {
+        int diagonal = row[0];
+        row[0] = static_cast<int>(i);
+        for (size_t j = 1; j <= rhs.size(); ++j) {
+            const int substitution = diagonal + (lhs[i - 1] == rhs[j - 1] ? 0 : 1);
+            diagonal = row[j];
+            row[j] = std::min({substitution, row[j] + 1, row[j - 1] + 1});
+        }
+    }
+
+    return row[rhs.size()];
+}
+
+void TestFuzzyMatching() {
+    // the trie walk finds what comparing with every term does
+    std::mt19937 generator(23);
+    TermDictionary dictionary;
+    const auto generate_term = [&generator]() {
+        std::string term(1 + generator() % 6, 'a');
+        for (char& c : term) {
+            c = static_cast<char>('a' + generator() % 3);
+        }
+        return term;
+    };
+    for (int i = 0; i < 500; ++i) {
+        dictionary.Insert(generate_term());
+    }
+
+    for (int i = 0; i < 50; ++i) {
+        const std::string word = generate_term();
+
+        for (int max_distance = 0; max_distance <= 2; ++max_distance) {
+            std::vector<std::pair<TermId, int>> expected;
+            for (TermId term_id = 0; term_id < dictionary.GetTermCount(); ++term_id) {
+                const int distance = ComputeEditDistance(word, dictionary.GetTerm(term_id));
+                if (distance <= max_distance) {
+                    expected.emplace_back(term_id, distance);
+                }
+            }
+
+            std::vector<std::pair<TermId, int>> found;
+            dictionary.FindSimilar(word, max_distance, expected.size() + 1, found);
+            ASSERT(std::is_sorted(found.begin(), found.end(), [](const auto& lhs, const auto& rhs) {
+                return lhs.second < rhs.second;
+            }));
+            std::sort(expected.begin(), expected.end());
+            std::vector<std::pair<TermId, int>> sorted_found = found;
+            std::sort(sorted_found.begin(), sorted_found.end());
+            ASSERT(sorted_found == expected);
+
+            // a bounded search keeps the closest terms
+            std::vector<std::pair<TermId, int>> closest;
+            dictionary.FindSimilar(word, max_distance, 3, closest);
+            ASSERT_EQUAL(closest.size(), std::min(found.size(), size_t(3)));
+            for (size_t j = 0; j < closest.size(); ++j) {
+                ASSERT_EQUAL(closest[j].second, found[j].second);
+            }
+        }
+    }
+
+    SearchServer server("and with"s);
+    server.AddDocument(0, "search engine"s, DocumentStatus::ACTUAL, {1});
+    server.AddDocument(1, "serch results"s, DocumentStatus::ACTUAL, {2});
+    server.AddDocument(2, "research paper"s, DocumentStatus::ACTUAL, {3});
+    server.AddDocument(3, "cat"s, DocumentStatus::ACTUAL, {4});
+    server.AddDocument(4, "cot"s, DocumentStatus::ACTUAL, {5});
+
+    const auto get_relevance = [&server](const std::string& query, int document_id) {
+        for (const Document& document : server.FindTopDocuments(query)) {
+            if (document.id == document_id) {
+                return document.relevance;
+            }
+        }
+        return 0.0;
+    };
+
+    ASSERT(server.FindTopDocuments("searh"s).empty());
+    const double search_relevance = get_relevance("search"s, 0);
+    const double serch_relevance = get_relevance("serch"s, 1);
+    const double research_relevance = get_relevance("research"s, 2);
+    const double cat_relevance = get_relevance("cat"s, 3);
+
+    server.SetFuzzyMatching(2);
+
+    // a typo costs half of the relevance, the typed word goes first
+    const std::vector<Document> found = server.FindTopDocuments("search"s);
+    ASSERT_EQUAL(found.size(), 3u);
+    ASSERT_EQUAL(found[0].id, 0);
+    ASSERT(std::abs(found[0].relevance - search_relevance) < EPS);
+    ASSERT(std::abs(get_relevance("search"s, 1) - serch_relevance * FUZZY_TERM_WEIGHT) < EPS);
+    ASSERT(std::abs(get_relevance("search"s, 2) - research_relevance * FUZZY_TERM_WEIGHT * FUZZY_TERM_WEIGHT) < EPS);
+
+    // shorter words get one edit, the shortest ones none
+    ASSERT(std::abs(get_relevance("searh"s, 0) - search_relevance * FUZZY_TERM_WEIGHT) < EPS);
+    ASSERT_EQUAL(server.FindTopDocuments("searh"s).size(), 1u);
+    ASSERT(std::abs(get_relevance("cut"s, 3) - cat_relevance * FUZZY_TERM_WEIGHT) < EPS);
+    ASSERT(server.FindTopDocuments("ct"s).empty());
+    // minus words are exact
+    ASSERT_EQUAL(server.FindTopDocuments("cot -cat"s).size(), 1u);
+    ASSERT_EQUAL(server.FindTopDocuments("cot -cut"s).size(), 2u);
+    ASSERT(server.ExplainQuery("searh zzzzz"s).skipped_words == std::vector<std::string>({"zzzzz"s}));
+
+    const auto [match_words, status] = server.MatchDocument("serch"s, 0);
+    ASSERT(match_words == std::vector<std::string_view>({"search"sv}));
+
+    // the same terms typed differently aren't the same cached query
+    server.EnableQueryCache(1 << 20);
+    for (int i = 0; i < 2; ++i) {
+        ASSERT_EQUAL(server.FindTopDocuments("cat"s).front().id, 3);
+        ASSERT_EQUAL(server.FindTopDocuments("cot"s).front().id, 4);
+    }
+
+    const std::vector<std::string> queries = {"cat"s, "cot"s, "cat"s, "serch"s, "paper"s, "engine paper"s};
+    const std::vector<std::vector<Document>> batch_results = server.FindTopDocumentsInBatch(std::execution::par, queries);
+    for (size_t i = 0; i < queries.size(); ++i) {
+        const std::vector<Document> expected = server.FindTopDocuments(queries[i]);
+
+        ASSERT_EQUAL(batch_results[i].size(), expected.size());
+        for (size_t j = 0; j < expected.size(); ++j) {
+            ASSERT_EQUAL(batch_results[i][j].id, expected[j].id);
+            ASSERT(std::abs(batch_results[i][j].relevance - expected[j].relevance) < EPS);
+        }
+    }
+
+    server.SetFuzzyMatching(0);
+    ASSERT(server.FindTopDocuments("searh"s).empty());
+
+    try {
+        server.SetFuzzyMatching(MAX_FUZZY_EDIT_DISTANCE + 1);
+        ASSERT_HINT(false, "too large edit distance must throw"s);
+    } catch (const std::invalid_argument&) {
+    }
+}
+
+void TestScoreKernels() {
+    std::mt19937 generator(24);
+    std::uniform_real_distribution<double> inv_word_count_distribution(0.001, 1.0);
+    std::vector<double> inv_word_counts(5000);
+    for (double& inv_word_count : inv_word_counts) {
+        inv_word_count = inv_word_count_distribution(generator);
+    }
+
+    // every length checks the tails after full vectors
+    for (size_t count = 0; count <= PostingList::BLOCK_SIZE; ++count) {
+        std::vector<uint32_t> ordinals(count);
+        std::vector<uint32_t> term_counts(count);
+        for (size_t i = 0; i < count; ++i) {
+            ordinals[i] = generator() % inv_word_counts.size();
+            term_counts[i] = 1 + generator() % 1000;
+        }
+
+        std::vector<double> expected(count);
+        ComputeScores(ScoreKernel::SCALAR, ordinals.data(), term_counts.data(), count, inv_word_counts.data(), 1.7, expected.data());
+        for (size_t i = 0; i < count; ++i) {
+            ASSERT_EQUAL(expected[i], term_counts[i] * inv_word_counts[ordinals[i]] * 1.7);
+        }
+
+        for (const ScoreKernel kernel : {ScoreKernel::SSE2, ScoreKernel::AVX2}) {
+            if (!IsScoreKernelSupported(kernel)) {
+                continue;
+            }
+
+            // the same to the bit
+            std::vector<double> scores(count);
+            ComputeScores(kernel, ordinals.data(), term_counts.data(), count, inv_word_counts.data(), 1.7, scores.data());
+            ASSERT(scores == expected);
+        }
+
+        std::vector<double> scores(count);
+        ComputeScores(ordinals.data(), term_counts.data(), count, inv_word_counts.data(), 1.7, scores.data());
+        ASSERT(scores == expected);
+    }
+
+    ASSERT(IsScoreKernelSupported(GetBestScoreKernel()));
+}
+
+void TestRemovingDocumentsInBulk() {
+    std::mt19937 generator(25);
+    SearchServer expected_server("and with"s);
+    SearchServer server("and with"s);
+    ShardedSearchServer sharded_server("and with"s, 3);
+
+    for (int id = 0; id < 4000; ++id) {
+        const std::string text = GenerateText(generator, 800, 20);
+        const DocumentStatus status = static_cast<DocumentStatus>(id % 3);
+
+        expected_server.AddDocument(id, text, status, {id % 10});
+        server.AddDocument(id, text, status, {id % 10});
+        sharded_server.AddDocument(id, text, status, {id % 10});
+    }
+    // a word only removed documents have
+    for (SearchServer* target : {&expected_server, &server}) {
+        target->AddDocument(100000, "lonely w1"s, DocumentStatus::ACTUAL, {5});
+    }
+
+    // absent and repeated ids are skipped
+    std::vector<int> removed_ids = {100000, 100000, -5, 123456};
+    size_t removed_count = 1;
+    for (int id = 0; id < 4000; ++id) {
+        if (generator() % 10 < 3) {
+            removed_ids.push_back(id);
+            ++removed_count;
+        }
+    }
+    for (const int id : removed_ids) {
+        expected_server.RemoveDocument(id);
+    }
+    server.RemoveDocuments(removed_ids);
+    sharded_server.RemoveDocuments(removed_ids);
+
+    ASSERT_EQUAL(server.GetTombstoneCount(), removed_count);
+    ASSERT_EQUAL(server.GetDocumentCount(), expected_server.GetDocumentCount());
+    ASSERT_EQUAL(sharded_server.GetDocumentCount(), expected_server.GetDocumentCount());
+    ASSERT(std::vector<int>(server.begin(), server.end()) == std::vector<int>(expected_server.begin(), expected_server.end()));
+    ASSERT(server.FindTopDocuments("lonely"s).empty());
+    try {
+        server.MatchDocument("w1"s, removed_ids.back());
+        ASSERT(false);
+    } catch (const std::out_of_range&) {
+    }
+
+    const auto check_same = [](const std::vector<Document>& found, const std::vector<Document>& expected) {
+        ASSERT_EQUAL(found.size(), expected.size());
+        for (size_t j = 0; j < found.size(); ++j) {
+            ASSERT_EQUAL(found[j].id, expected[j].id);
+            ASSERT(std::abs(found[j].relevance - expected[j].relevance) < EPS);
+        }
+    };
+
+    std::vector<std::string> queries;
+    for (int i = 0; i < 40; ++i) {
+        queries.push_back(GenerateText(generator, 800, 1 + i % 8) + (i % 2 == 0 ? " -"s + GenerateText(generator, 800, 1) : ""s));
+    }
+    queries.push_back("lonely w1"s);
+    queries.push_back("w1*"s);
+
+    const auto is_even = [](int document_id, DocumentStatus, int) {
+        return document_id % 2 == 0;
+    };
+    const auto check_queries = [&](const SearchServer& target) {
+        const std::vector<std::vector<Document>> batch_results = target.FindTopDocumentsInBatch(std::execution::par, queries);
+
+        for (size_t i = 0; i < queries.size(); ++i) {
+            const std::string& query = queries[i];
+
+            check_same(target.FindTopDocuments(query), expected_server.FindTopDocuments(query));
+            check_same(target.FindTopDocuments(std::execution::par, query, DocumentStatus::BANNED),
+                       expected_server.FindTopDocuments(query, DocumentStatus::BANNED));
+            check_same(target.FindTopDocuments(std::execution::seq, query, ByMinRating{7}),
+                       expected_server.FindTopDocuments(std::execution::seq, query, ByMinRating{7}));
+            check_same(target.FindTopDocuments(std::execution::par, query, is_even),
+                       expected_server.FindTopDocuments(std::execution::par, query, is_even));
+            check_same(batch_results[i], expected_server.FindTopDocuments(query));
+            ASSERT(target.GetStatistics(query).document_freqs == expected_server.GetStatistics(query).document_freqs);
+        }
+    };
+
+    // tombstones are honored before compaction, after saving and after compaction alike
+    check_queries(server);
+    for (size_t i = 0; i < 20; ++i) {
+        check_same(sharded_server.FindTopDocuments(queries[i]), expected_server.FindTopDocuments(queries[i]));
+    }
+
+    const std::string path = (std::filesystem::temp_directory_path() / "search_engine_tombstone_test.bin").string();
+    server.SaveIndex(path);
+    {
+        SearchServer opened = SearchServer::OpenIndex(path);
+        ASSERT_EQUAL(opened.GetTombstoneCount(), removed_count);
+        check_queries(opened);
+
+        opened.Compact();
+        ASSERT_EQUAL(opened.GetTombstoneCount(), 0u);
+        check_queries(opened);
+    }
+    std::filesystem::remove(path);
+
+    server.Compact(std::execution::par);
+    ASSERT_EQUAL(server.GetTombstoneCount(), 0u);
+    check_queries(server);
+    server.Compact();
+
+    sharded_server.Compact();
+    for (size_t i = 0; i < 20; ++i) {
+        check_same(sharded_server.FindTopDocuments(queries[i]), expected_server.FindTopDocuments(queries[i]));
+    }
+
+    // a removed id may be added again, and the index keeps working with both kinds of removal
+    for (SearchServer* target : {&expected_server, &server}) {
+        target->AddDocument(removed_ids.back(), "lonely again"s, DocumentStatus::ACTUAL, {1});
+        target->RemoveDocument(1);
+    }
+    server.RemoveDocuments(std::vector<int>{2, 4, 6});
+    for (const int id : {2, 4, 6}) {
+        expected_server.RemoveDocument(id);
+    }
+    check_queries(server);
+    ASSERT_EQUAL(server.FindTopDocuments("lonely"s).size(), 1u);
+}
+
+void TestSegmentedSearchServer() {
+    std::mt19937 generator(6);
+    SearchServer expected_server("and with"s);
+    SegmentedSearchServer server("and with"s, 64);
+
+    // queries go on while documents are added and segments are merged
+    std::atomic_bool is_adding = true;
+    std::thread reader([&]() {
+        std::mt19937 reader_generator(7);
+
+        while (is_adding) {
+            ASSERT(server.FindTopDocuments(GenerateText(reader_generator, 500, 3)).size() <= 5u);
+        }
+    });
+
+    for (int id = 0; id < 3000; ++id) {
+        const std::string text = GenerateText(generator, 500, 20);
+        const DocumentStatus status = static_cast<DocumentStatus>(id % 3);
+
+        expected_server.AddDocument(id, text, status, {id % 10});
+        server.AddDocument(id, text, status, {id % 10});
+    }
+    // removed both from sealed segments and from the buffer
+    for (int id = 0; id < 3000; id += 7) {
+        expected_server.RemoveDocument(id);
+        server.RemoveDocument(id);
+    }
+    is_adding = false;
+    reader.join();
+
+    try {
+        server.AddDocument(1, "again"s, DocumentStatus::ACTUAL, {});
+        ASSERT(false);
+    } catch (const std::invalid_argument&) {
+    }
+
+    const auto check_same_results = [&]() {
+        ASSERT_EQUAL(server.GetDocumentCount(), expected_server.GetDocumentCount());
+
+        for (int i = 0; i < 50; ++i) {
+            const std::string query = GenerateText(generator, 500, 3) + " -"s + GenerateText(generator, 500, 1);
+            const std::vector<Document> expected = expected_server.FindTopDocuments(query, DocumentStatus::IRRELEVANT);
+            const std::vector<Document> found = server.FindTopDocuments(query, DocumentStatus::IRRELEVANT);
+
+            ASSERT_EQUAL(found.size(), expected.size());
+            for (size_t j = 0; j < found.size(); ++j) {
+                ASSERT_EQUAL(found[j].id, expected[j].id);
+                ASSERT(std::abs(found[j].relevance - expected[j].relevance) < EPS);
+            }
+
+            const auto is_odd = [](int document_id, DocumentStatus, int) {
+                return document_id % 2 == 1;
+            };
+            const std::vector<Document> expected_odd = expected_server.FindTopDocuments(query, is_odd);
+            const std::vector<Document> found_odd = server.FindTopDocuments(query, is_odd);
+
+            ASSERT_EQUAL(found_odd.size(), expected_odd.size());
+            for (size_t j = 0; j < found_odd.size(); ++j) {
+                ASSERT_EQUAL(found_odd[j].id, expected_odd[j].id);
+                ASSERT(std::abs(found_odd[j].relevance - expected_odd[j].relevance) < EPS);
+            }
+        }
+    };
+
+    server.Refresh();
+    ASSERT(server.GetSegmentCount() > 1u);
+    check_same_results();
+
+    server.Merge();
+    ASSERT_EQUAL(server.GetSegmentCount(), 1u);
+    check_same_results();
+
+    // a mass removal from a big sealed segment is honored at once and dropped by the next merge
+    for (int id = 1; id < 3000; id += 3) {
+        expected_server.RemoveDocument(id);
+        server.RemoveDocument(id);
+    }
+    check_same_results();
+    server.Merge();
+    ASSERT_EQUAL(server.GetSegmentCount(), 1u);
+    check_same_results();
+
+    // deletion sets are versions: deleting more leaves the old set as it was
+    SearchServer index("and with"s);
+    index.AddDocument(1, "white cat"s, DocumentStatus::ACTUAL, {});
+    index.AddDocument(2, "black cat"s, DocumentStatus::ACTUAL, {});
+    const DeletionSet first = index.DeleteDocuments(DeletionSet(), std::vector<int>{1, 5});
+    const DeletionSet second = index.DeleteDocuments(first, std::vector<int>{1, 2});
+    ASSERT_EQUAL(first.GetDocumentCount(), 1u);
+    ASSERT_EQUAL(second.GetDocumentCount(), 2u);
+    ASSERT_EQUAL(index.GetStatistics("cat white"s, first).document_freqs.at("cat"s), 1);
+    ASSERT_EQUAL(index.GetStatistics("cat white"s, first).document_freqs.at("white"s), 0);
+    ASSERT_EQUAL(index.GetStatistics("cat"s, second).document_count, 0);
+    ASSERT_EQUAL(index.GetDocumentCount(), 2);
+}
+
 int main() {
     RUN_TEST(TestExcludeStopWordsFromAddedDocumentContent);
     RUN_TEST(TestDocumentsCount);
     RUN_TEST(TestAddingDocument);
     RUN_TEST(TestExcludeDocumentsWithMinusWordsFromSearchResult);
     RUN_TEST(TestMatchingDocument);
+    RUN_TEST(TestRemovingDocument);
     RUN_TEST(TestDocumentRelevance);
     RUN_TEST(TestDocumentRating);
     RUN_TEST(TestSearchResultWithComparator);
     RUN_TEST(TestSearchResultToDocumentStatus);
     RUN_TEST(TestRelevanceCalculating);
     RUN_TEST(TestProcessQueries);
+    RUN_TEST(TestParallelSearchMatchesSequential);
+    RUN_TEST(TestTopDocumentsMatchExhaustiveSearch);
+    RUN_TEST(TestPostingListCompression);
+    RUN_TEST(TestSaveAndOpenIndex);
+    RUN_TEST(TestAddingDocumentsInBulk);
+    RUN_TEST(TestTokenizer);
+    RUN_TEST(TestQueryAllocations);
+    RUN_TEST(TestFilteringByStatusBitmaps);
+    RUN_TEST(TestIndexedComparators);
+    RUN_TEST(TestMinusWordsExclusion);
+    RUN_TEST(TestQueryPlanner);
+    RUN_TEST(TestMatchingDocumentsInBatch);
+    RUN_TEST(TestShardedSearchServer);
+    RUN_TEST(TestProcessQueriesInBatch);
+    RUN_TEST(TestProcessQueriesStreaming);
+    RUN_TEST(TestFindTopDocumentsAsync);
+    RUN_TEST(TestQueryCache);
+    RUN_TEST(TestRemoveDuplicates);
+    RUN_TEST(TestSearchCursor);
+    RUN_TEST(TestPatternQueries);
+    RUN_TEST(TestFuzzyMatching);
+    RUN_TEST(TestScoreKernels);
+    RUN_TEST(TestRemovingDocumentsInBulk);
+    RUN_TEST(TestSegmentedSearchServer);
 
     return 0;
 }
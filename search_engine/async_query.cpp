@@ -0,0 +1,112 @@
+#include "async_query.h"
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <future>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+
+#include "document.h"
+
+using namespace std::string_literals;
+
+namespace {
+
+// the shared executor takes that many queries per thread before rejecting them
+const size_t SHARED_ADMITTED_PER_THREAD = 4;
+
+}  // namespace
+
+QueryControl::QueryControl(std::chrono::steady_clock::time_point deadline) : deadline_(deadline) {
+}
+
+void QueryControl::Cancel() {
+    is_cancelled_ = true;
+}
+
+bool QueryControl::ShouldStop() {
+    if (status_ != QueryStatus::COMPLETE) {
+        return true;
+    }
+
+    QueryStatus status = QueryStatus::COMPLETE;
+    if (is_cancelled_) {
+        status = QueryStatus::CANCELLED;
+    } else if (std::chrono::steady_clock::now() >= deadline_) {
+        status = QueryStatus::DEADLINE_EXCEEDED;
+    } else {
+        return false;
+    }
+
+    // workers of a parallel query may stop at once, the first reason wins
+    QueryStatus expected = QueryStatus::COMPLETE;
+    status_.compare_exchange_strong(expected, status);
+    return true;
+}
+
+QueryStatus QueryControl::GetStatus() const {
+    return status_;
+}
+
+QueryHandle::QueryHandle(std::future<AsyncQueryResult> result, std::shared_ptr<QueryControl> control)
+    : result_(std::move(result)), control_(std::move(control)) {
+}
+
+void QueryHandle::Cancel() {
+    control_->Cancel();
+}
+
+bool QueryHandle::IsReady() const {
+    return result_.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+}
+
+bool QueryHandle::WaitUntil(std::chrono::steady_clock::time_point time) const {
+    return result_.wait_until(time) == std::future_status::ready;
+}
+
+AsyncQueryResult QueryHandle::Get() {
+    return result_.get();
+}
+
+QueryExecutor::QueryExecutor(size_t thread_count, size_t max_admitted_count)
+    : max_admitted_count_(max_admitted_count), thread_pool_(thread_count) {
+    if (thread_count == 0) {
+        throw std::invalid_argument("Thread count must be positive"s);
+    }
+}
+
+QueryExecutor& QueryExecutor::GetShared() {
+    static const size_t thread_count = std::max(std::thread::hardware_concurrency(), 1u);
+    static QueryExecutor executor(thread_count, thread_count * SHARED_ADMITTED_PER_THREAD);
+
+    return executor;
+}
+
+std::future<AsyncQueryResult> QueryExecutor::Submit(std::function<AsyncQueryResult()> query) {
+    if (admitted_count_.fetch_add(1) >= max_admitted_count_) {
+        --admitted_count_;
+
+        std::promise<AsyncQueryResult> rejected;
+        rejected.set_value({{}, QueryStatus::REJECTED});
+        return rejected.get_future();
+    }
+
+    return thread_pool_.Submit([this, query = std::move(query)]() {
+        try {
+            AsyncQueryResult result = query();
+            --admitted_count_;
+            return result;
+        } catch (...) {
+            --admitted_count_;
+            throw;
+        }
+    });
+}
+
+size_t QueryExecutor::GetAdmittedCount() const {
+    return admitted_count_;
+}
@@ -0,0 +1,78 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <future>
+#include <memory>
+#include <vector>
+
+#include "../helpers/thread_pool/thread_pool.h"
+#include "document.h"
+
+enum class QueryStatus {
+    COMPLETE,
+    DEADLINE_EXCEEDED,  // documents are the top of the ones scored before the deadline
+    CANCELLED,          // documents are the top of the ones scored before the cancellation
+    REJECTED            // the executor had too many queries, nothing was scored
+};
+
+struct AsyncQueryResult {
+    std::vector<Document> documents;
+    QueryStatus status = QueryStatus::COMPLETE;
+};
+
+// Stop conditions of a running query. Scoring asks it from time to time whether to stop,
+// and the first reason it got stays its status
+class QueryControl {
+   public:
+    explicit QueryControl(std::chrono::steady_clock::time_point deadline);
+
+    void Cancel();
+    bool ShouldStop();
+    QueryStatus GetStatus() const;
+
+   private:
+    std::chrono::steady_clock::time_point deadline_;
+    std::atomic_bool is_cancelled_ = false;
+    std::atomic<QueryStatus> status_ = QueryStatus::COMPLETE;
+};
+
+// Result of an asynchronous query, like a future of it which can also stop the query
+class QueryHandle {
+   public:
+    QueryHandle(std::future<AsyncQueryResult> result, std::shared_ptr<QueryControl> control);
+
+    // the query stops at the next check and gives the documents scored so far
+    void Cancel();
+
+    bool IsReady() const;
+    // whether the result is ready by the time
+    bool WaitUntil(std::chrono::steady_clock::time_point time) const;
+    // waits for the result and rethrows an exception of the query, can be called once
+    AsyncQueryResult Get();
+
+   private:
+    std::future<AsyncQueryResult> result_;
+    std::shared_ptr<QueryControl> control_;
+};
+
+// Threads running asynchronous queries. At most max_admitted_count queries are queued or running
+// at once, the ones above are rejected right away instead of waiting for longer than their deadline
+class QueryExecutor {
+   public:
+    QueryExecutor(size_t thread_count, size_t max_admitted_count);
+
+    // the executor of queries which don't give their own one
+    static QueryExecutor& GetShared();
+
+    std::future<AsyncQueryResult> Submit(std::function<AsyncQueryResult()> query);
+
+    size_t GetAdmittedCount() const;
+
+   private:
+    size_t max_admitted_count_;
+    std::atomic<size_t> admitted_count_ = 0;
+    // the last member, so its threads are joined before the counter is gone
+    ThreadPool thread_pool_;
+};
@@ -0,0 +1,140 @@
+#include "bit_packing.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+const size_t LANE_COUNT = 4;
+const size_t VALUES_PER_LANE = BIT_PACKING_BLOCK_SIZE / LANE_COUNT;
+
+}  // namespace
+
+int ComputeBitWidth(const uint32_t* values, size_t count) {
+    uint32_t accumulated = 0;
+    for (size_t i = 0; i < count; ++i) {
+        accumulated |= values[i];
+    }
+
+    int bit_width = 0;
+    while (bit_width < 32 && (accumulated >> bit_width) != 0u) {
+        ++bit_width;
+    }
+
+    return bit_width;
+}
+
+size_t GetPackedWordCount(int bit_width) {
+    return LANE_COUNT * bit_width;
+}
+
+void PackBits(const uint32_t* values, int bit_width, uint32_t* out) {
+    std::fill(out, out + GetPackedWordCount(bit_width), 0u);
+
+    if (bit_width == 0) {
+        return;
+    }
+
+    for (size_t lane = 0; lane < LANE_COUNT; ++lane) {
+        size_t bit_position = 0;
+
+        for (size_t i = 0; i < VALUES_PER_LANE; ++i) {
+            const uint32_t value = values[i * LANE_COUNT + lane];
+            const size_t word = bit_position / 32;
+            const size_t shift = bit_position % 32;
+
+            out[word * LANE_COUNT + lane] |= value << shift;
+            if (shift + bit_width > 32) {
+                out[(word + 1) * LANE_COUNT + lane] |= value >> (32 - shift);
+            }
+
+            bit_position += bit_width;
+        }
+    }
+}
+
+#if defined(__SSE2__)
+
+void UnpackBits(const uint32_t* in, int bit_width, uint32_t* values) {
+    __m128i* out = reinterpret_cast<__m128i*>(values);
+
+    if (bit_width == 0) {
+        std::fill(values, values + BIT_PACKING_BLOCK_SIZE, 0u);
+        return;
+    }
+
+    const __m128i* words = reinterpret_cast<const __m128i*>(in);
+    const __m128i mask = _mm_set1_epi32(bit_width == 32 ? -1 : static_cast<int>((1u << bit_width) - 1));
+    size_t bit_position = 0;
+
+    for (size_t i = 0; i < VALUES_PER_LANE; ++i) {
+        const size_t word = bit_position / 32;
+        const int shift = static_cast<int>(bit_position % 32);
+
+        __m128i value = _mm_srl_epi32(_mm_loadu_si128(words + word), _mm_cvtsi32_si128(shift));
+        if (shift + bit_width > 32) {
+            const __m128i high = _mm_sll_epi32(_mm_loadu_si128(words + word + 1), _mm_cvtsi32_si128(32 - shift));
+            value = _mm_or_si128(value, high);
+        }
+        _mm_storeu_si128(out + i, _mm_and_si128(value, mask));
+
+        bit_position += bit_width;
+    }
+}
+
+void RestoreFromDeltas(uint32_t* values, uint32_t base) {
+    __m128i* data = reinterpret_cast<__m128i*>(values);
+    __m128i carry = _mm_set1_epi32(static_cast<int>(base));
+
+    for (size_t i = 0; i < VALUES_PER_LANE; ++i) {
+        __m128i value = _mm_loadu_si128(data + i);
+        value = _mm_add_epi32(value, _mm_slli_si128(value, 4));
+        value = _mm_add_epi32(value, _mm_slli_si128(value, 8));
+        value = _mm_add_epi32(value, carry);
+        _mm_storeu_si128(data + i, value);
+
+        carry = _mm_shuffle_epi32(value, _MM_SHUFFLE(3, 3, 3, 3));
+    }
+}
+
+#else
+
+void UnpackBits(const uint32_t* in, int bit_width, uint32_t* values) {
+    if (bit_width == 0) {
+        std::fill(values, values + BIT_PACKING_BLOCK_SIZE, 0u);
+        return;
+    }
+
+    const uint32_t mask = bit_width == 32 ? UINT32_MAX : (1u << bit_width) - 1;
+
+    for (size_t lane = 0; lane < LANE_COUNT; ++lane) {
+        size_t bit_position = 0;
+
+        for (size_t i = 0; i < VALUES_PER_LANE; ++i) {
+            const size_t word = bit_position / 32;
+            const size_t shift = bit_position % 32;
+
+            uint32_t value = in[word * LANE_COUNT + lane] >> shift;
+            if (shift + bit_width > 32) {
+                value |= in[(word + 1) * LANE_COUNT + lane] << (32 - shift);
+            }
+            values[i * LANE_COUNT + lane] = value & mask;
+
+            bit_position += bit_width;
+        }
+    }
+}
+
+void RestoreFromDeltas(uint32_t* values, uint32_t base) {
+    for (size_t i = 0; i < BIT_PACKING_BLOCK_SIZE; ++i) {
+        base += values[i];
+        values[i] = base;
+    }
+}
+
+#endif
@@ -0,0 +1,22 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// Block codec in the SIMD-BP128 layout: BIT_PACKING_BLOCK_SIZE integers are split into 4 lanes
+// (value i goes to lane i % 4) and every lane is packed with the same bit width into interleaved
+// 32-bit words, so a block of width b takes 4 * b words and one SSE register unpacks 4 values at once
+const size_t BIT_PACKING_BLOCK_SIZE = 128;
+
+// minimal width that fits all the values
+int ComputeBitWidth(const uint32_t* values, size_t count);
+
+size_t GetPackedWordCount(int bit_width);
+
+// values must hold BIT_PACKING_BLOCK_SIZE integers, out must hold GetPackedWordCount(bit_width) words
+void PackBits(const uint32_t* values, int bit_width, uint32_t* out);
+
+// values must have room for BIT_PACKING_BLOCK_SIZE integers
+void UnpackBits(const uint32_t* in, int bit_width, uint32_t* values);
+
+// turns BIT_PACKING_BLOCK_SIZE deltas into values: values[i] = base + deltas[0] + ... + deltas[i]
+void RestoreFromDeltas(uint32_t* values, uint32_t base);
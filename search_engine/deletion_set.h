@@ -0,0 +1,118 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "term_dictionary.h"
+
+// Documents deleted from an index which can't change, like a segment being queried, with the number
+// of their postings by term. A set is never changed: deleting gives a new set which shares all but the
+// changed chunks with the old one, so a deletion copies the chunk tables and a chunk per term of the
+// document instead of the whole set, and the old set stays valid for the queries reading it
+class DeletionSet {
+    struct Data;
+
+   public:
+    bool Contains(uint32_t ordinal) const {
+        const OrdinalChunk* chunk = data_ == nullptr ? nullptr : FindChunk(data_->ordinal_chunks, ordinal / CHUNK_BIT_COUNT);
+        const uint32_t bit = ordinal % CHUNK_BIT_COUNT;
+
+        return chunk != nullptr && (((*chunk)[bit / 64] >> (bit % 64)) & 1u) != 0u;
+    }
+
+    size_t GetDocumentCount() const {
+        return data_ == nullptr ? 0u : data_->document_count;
+    }
+
+    uint32_t GetPostingCount(TermId term_id) const {
+        const PostingCountChunk* chunk = data_ == nullptr ? nullptr : FindChunk(data_->posting_count_chunks, term_id / CHUNK_SIZE);
+
+        return chunk == nullptr ? 0u : (*chunk)[term_id % CHUNK_SIZE];
+    }
+
+    // Makes a set of more deletions. Chunks are copied when a deletion first touches them, so a batch of
+    // deletions copies every chunk at most once
+    class Builder {
+       public:
+        explicit Builder(const DeletionSet& deletions)
+            : data_(deletions.data_ == nullptr ? std::make_shared<Data>() : std::make_shared<Data>(*deletions.data_)) {
+        }
+
+        // false if the document is deleted already
+        bool Add(uint32_t ordinal, const TermId* term_ids_begin, const TermId* term_ids_end) {
+            OrdinalChunk& chunk = EditChunk(data_->ordinal_chunks, copied_ordinal_chunks_, ordinal / CHUNK_BIT_COUNT);
+            const uint32_t bit = ordinal % CHUNK_BIT_COUNT;
+            const uint64_t mask = uint64_t{1} << (bit % 64);
+
+            if ((chunk[bit / 64] & mask) != 0u) {
+                return false;
+            }
+            chunk[bit / 64] |= mask;
+            ++data_->document_count;
+
+            for (const TermId* term_id = term_ids_begin; term_id != term_ids_end; ++term_id) {
+                ++EditChunk(data_->posting_count_chunks, copied_posting_count_chunks_, *term_id / CHUNK_SIZE)[*term_id % CHUNK_SIZE];
+            }
+
+            return true;
+        }
+
+        DeletionSet Build() {
+            DeletionSet deletions;
+            deletions.data_ = std::make_shared<const Data>(*data_);
+
+            // the built set owns the chunks now, further additions copy them again
+            copied_ordinal_chunks_.assign(copied_ordinal_chunks_.size(), false);
+            copied_posting_count_chunks_.assign(copied_posting_count_chunks_.size(), false);
+
+            return deletions;
+        }
+
+       private:
+        std::shared_ptr<Data> data_;
+        std::vector<bool> copied_ordinal_chunks_;
+        std::vector<bool> copied_posting_count_chunks_;
+
+        template <typename Chunk>
+        static Chunk& EditChunk(std::vector<std::shared_ptr<Chunk>>& chunks, std::vector<bool>& copied_chunks, size_t index) {
+            if (index >= chunks.size()) {
+                chunks.resize(index + 1);
+            }
+            if (index >= copied_chunks.size()) {
+                copied_chunks.resize(index + 1, false);
+            }
+
+            if (!copied_chunks[index]) {
+                chunks[index] = chunks[index] == nullptr ? std::make_shared<Chunk>() : std::make_shared<Chunk>(*chunks[index]);
+                copied_chunks[index] = true;
+            }
+
+            return *chunks[index];
+        }
+    };
+
+   private:
+    static const size_t CHUNK_SIZE = 64;
+    static const size_t CHUNK_BIT_COUNT = CHUNK_SIZE * 64;
+
+    using OrdinalChunk = std::array<uint64_t, CHUNK_SIZE>;
+    using PostingCountChunk = std::array<uint32_t, CHUNK_SIZE>;
+
+    // chunks are shared between sets and never changed once a set is built
+    struct Data {
+        std::vector<std::shared_ptr<OrdinalChunk>> ordinal_chunks;
+        std::vector<std::shared_ptr<PostingCountChunk>> posting_count_chunks;
+        size_t document_count = 0;
+    };
+
+    // null for the empty set, so copying a set copies a pointer
+    std::shared_ptr<const Data> data_;
+
+    // null if nothing of the chunk is deleted
+    template <typename Chunk>
+    static const Chunk* FindChunk(const std::vector<std::shared_ptr<Chunk>>& chunks, size_t index) {
+        return index < chunks.size() ? chunks[index].get() : nullptr;
+    }
+};
@@ -1,5 +1,6 @@
 #include "document.h"
 
+#include <cmath>
 #include <iostream>
 #include <string>
 
@@ -8,6 +9,16 @@ Document::Document(int id, double relevance, int rating) : id(id), relevance(rel
 Document::Document(int id, double relevance, int rating, DocumentStatus status) : id(id), relevance(relevance), rating(rating), status(status) {}
 Document::Document(int rating, DocumentStatus status) : rating(rating), status(status) {}
 
+bool IsMoreRelevant(const Document& lhs, const Document& rhs) {
+    if (std::abs(lhs.relevance - rhs.relevance) >= EPS) {
+        return lhs.relevance > rhs.relevance;
+    } else if (lhs.rating != rhs.rating) {
+        return lhs.rating > rhs.rating;
+    }
+
+    return lhs.id < rhs.id;
+}
+
 std::ostream& operator<<(std::ostream& os, const Document& document) {
     using namespace std::string_literals;
 
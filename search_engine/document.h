@@ -1,6 +1,8 @@
 #pragma once
 #include <iostream>
 
+const double EPS = 1e-6;
+
 enum class DocumentStatus {
     ACTUAL,
     IRRELEVANT,
@@ -20,4 +22,26 @@ struct Document {
     Document(int rating, DocumentStatus status);
 };
 
+// Comparators which FindTopDocuments recognizes at compile time and evaluates with its status bitmaps
+// and rating arrays. Elsewhere they work like any other comparator
+struct ByStatus {
+    DocumentStatus status;
+
+    bool operator()(int, DocumentStatus document_status, int) const {
+        return document_status == status;
+    }
+};
+
+struct ByMinRating {
+    int min_rating;
+
+    bool operator()(int, DocumentStatus, int rating) const {
+        return rating >= min_rating;
+    }
+};
+
+// Order of search results: documents with equal relevance (up to EPS) are ordered
+// by rating, and then by id to make the order total
+bool IsMoreRelevant(const Document& lhs, const Document& rhs);
+
 std::ostream& operator<<(std::ostream& os, const Document& document);
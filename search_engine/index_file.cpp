@@ -0,0 +1,98 @@
+#include "index_file.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstddef>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+
+using namespace std::string_literals;
+
+MappedFile::MappedFile(const std::string& path) {
+    const int fd = open(path.c_str(), O_RDONLY);
+    if (fd == -1) {
+        throw std::runtime_error("Can't open index file "s + path);
+    }
+
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) == -1) {
+        close(fd);
+        throw std::runtime_error("Can't read index file "s + path);
+    }
+
+    size_ = static_cast<size_t>(file_stat.st_size);
+    if (size_ > 0u) {
+        void* data = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+
+        if (data == MAP_FAILED) {
+            close(fd);
+            throw std::runtime_error("Can't map index file "s + path);
+        }
+
+        data_ = static_cast<const char*>(data);
+    }
+
+    // the mapping stays valid after closing
+    close(fd);
+}
+
+MappedFile::~MappedFile() {
+    if (data_ != nullptr) {
+        munmap(const_cast<char*>(data_), size_);
+    }
+}
+
+const char* MappedFile::GetData() const {
+    return data_;
+}
+
+size_t MappedFile::GetSize() const {
+    return size_;
+}
+
+IndexWriter::IndexWriter(const std::string& path) : out_(path, std::ios::binary | std::ios::trunc) {
+    if (!out_) {
+        throw std::runtime_error("Can't create index file "s + path);
+    }
+
+    WriteValue(INDEX_FILE_MAGIC);
+    WriteValue(INDEX_FILE_VERSION);
+}
+
+void IndexWriter::Finish() {
+    out_.flush();
+
+    if (!out_) {
+        throw std::runtime_error("Can't write index file"s);
+    }
+}
+
+void IndexWriter::Write(const void* data, size_t size) {
+    out_.write(static_cast<const char*>(data), static_cast<std::streamsize>(size));
+    offset_ += size;
+}
+
+IndexReader::IndexReader(const MappedFile& file) : data_(file.GetData()), size_(file.GetSize()) {
+    if (ReadValue<uint32_t>() != INDEX_FILE_MAGIC) {
+        throw std::runtime_error("Not an index file"s);
+    }
+
+    if (ReadValue<uint32_t>() != INDEX_FILE_VERSION) {
+        throw std::runtime_error("Unsupported index file version"s);
+    }
+}
+
+const char* IndexReader::Read(size_t size) {
+    if (size > size_ - offset_) {
+        throw std::runtime_error("Index file is truncated"s);
+    }
+
+    const char* data = data_ + offset_;
+    offset_ += size;
+
+    return data;
+}
@@ -0,0 +1,126 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+
+#include "mappable_vector.h"
+
+// Binary index snapshot: a header followed by values and arrays in native byte order. Every array is
+// prefixed by its length and aligned to ARRAY_ALIGNMENT, so it can be used right from mapped memory.
+// Hash tables are stored as is, so a file is meant to be read by the same build that wrote it
+const uint32_t INDEX_FILE_MAGIC = 0x58444953;  // "SIDX"
+const uint32_t INDEX_FILE_VERSION = 3;
+
+// Read-only memory mapping of a whole file, unmapped on destruction
+class MappedFile {
+   public:
+    explicit MappedFile(const std::string& path);
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    ~MappedFile();
+
+    const char* GetData() const;
+    size_t GetSize() const;
+
+   private:
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+};
+
+class IndexWriter {
+   public:
+    // writes the header
+    explicit IndexWriter(const std::string& path);
+
+    template <typename Type>
+    void WriteValue(const Type& value);
+
+    template <typename Type>
+    void WriteArray(const Type* data, size_t size);
+
+    template <typename Container>
+    void WriteArray(const Container& container);
+
+    // makes sure everything is on disk
+    void Finish();
+
+   private:
+    static const size_t ARRAY_ALIGNMENT = 8;
+
+    std::ofstream out_;
+    size_t offset_ = 0;
+
+    void Write(const void* data, size_t size);
+};
+
+class IndexReader {
+   public:
+    // checks the header; the reader refers to the file data, so the file must outlive everything read from it
+    explicit IndexReader(const MappedFile& file);
+
+    template <typename Type>
+    Type ReadValue();
+
+    template <typename Type>
+    MappableVector<Type> ReadArray();
+
+   private:
+    static const size_t ARRAY_ALIGNMENT = 8;
+
+    const char* data_;
+    size_t size_;
+    size_t offset_ = 0;
+
+    const char* Read(size_t size);
+};
+
+template <typename Type>
+void IndexWriter::WriteValue(const Type& value) {
+    static_assert(std::is_trivially_copyable_v<Type>);
+
+    Write(&value, sizeof(Type));
+}
+
+template <typename Type>
+void IndexWriter::WriteArray(const Type* data, size_t size) {
+    static_assert(std::is_trivially_copyable_v<Type>);
+
+    WriteValue<uint64_t>(size);
+
+    const char padding[ARRAY_ALIGNMENT] = {};
+    Write(padding, (ARRAY_ALIGNMENT - offset_ % ARRAY_ALIGNMENT) % ARRAY_ALIGNMENT);
+    Write(data, size * sizeof(Type));
+}
+
+template <typename Container>
+void IndexWriter::WriteArray(const Container& container) {
+    WriteArray(container.data(), container.size());
+}
+
+template <typename Type>
+Type IndexReader::ReadValue() {
+    static_assert(std::is_trivially_copyable_v<Type>);
+
+    Type value;
+    std::copy_n(Read(sizeof(Type)), sizeof(Type), reinterpret_cast<char*>(&value));
+
+    return value;
+}
+
+template <typename Type>
+MappableVector<Type> IndexReader::ReadArray() {
+    static_assert(std::is_trivially_copyable_v<Type>);
+
+    const uint64_t size = ReadValue<uint64_t>();
+    Read((ARRAY_ALIGNMENT - offset_ % ARRAY_ALIGNMENT) % ARRAY_ALIGNMENT);
+
+    if (size > (size_ - offset_) / sizeof(Type)) {
+        throw std::runtime_error("Index file is truncated");
+    }
+
+    return MappableVector<Type>::Map(reinterpret_cast<const Type*>(Read(size * sizeof(Type))), size);
+}
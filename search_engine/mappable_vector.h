@@ -0,0 +1,71 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+
+// Array which either owns its elements or refers to read-only memory of a mapped index file.
+// Reading doesn't care about the difference; Edit copies mapped elements into own storage first,
+// so an index opened from a file stays usable for writing
+template <typename Type>
+class MappableVector {
+   public:
+    MappableVector() = default;
+
+    static MappableVector Map(const Type* data, size_t size) {
+        MappableVector result;
+        result.mapped_data_ = data;
+        result.mapped_size_ = size;
+
+        return result;
+    }
+
+    bool IsMapped() const {
+        return mapped_data_ != nullptr;
+    }
+
+    const Type* data() const {
+        return IsMapped() ? mapped_data_ : owned_.data();
+    }
+
+    size_t size() const {
+        return IsMapped() ? mapped_size_ : owned_.size();
+    }
+
+    bool empty() const {
+        return size() == 0u;
+    }
+
+    const Type& operator[](size_t index) const {
+        return data()[index];
+    }
+
+    const Type& back() const {
+        return data()[size() - 1];
+    }
+
+    const Type* begin() const {
+        return data();
+    }
+
+    const Type* end() const {
+        return data() + size();
+    }
+
+    std::vector<Type>& Edit() {
+        if (IsMapped()) {
+            owned_.assign(mapped_data_, mapped_data_ + mapped_size_);
+            mapped_data_ = nullptr;
+            mapped_size_ = 0;
+        }
+
+        return owned_;
+    }
+
+    size_t GetMemoryUsage() const {
+        return owned_.capacity() * sizeof(Type);
+    }
+
+   private:
+    std::vector<Type> owned_;
+    const Type* mapped_data_ = nullptr;
+    size_t mapped_size_ = 0;
+};
@@ -0,0 +1,42 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Set of document ordinals, a bit per ordinal. Ordinals are dense, so it's smaller and faster
+// than any hash set of them
+class OrdinalBitmap {
+   public:
+    void Set(uint32_t ordinal) {
+        const size_t word = ordinal / WORD_BIT_COUNT;
+
+        if (word >= words_.size()) {
+            words_.resize(word + 1, 0u);
+        }
+
+        words_[word] |= uint64_t{1} << (ordinal % WORD_BIT_COUNT);
+    }
+
+    void Reset(uint32_t ordinal) {
+        const size_t word = ordinal / WORD_BIT_COUNT;
+
+        if (word < words_.size()) {
+            words_[word] &= ~(uint64_t{1} << (ordinal % WORD_BIT_COUNT));
+        }
+    }
+
+    bool Test(uint32_t ordinal) const {
+        const size_t word = ordinal / WORD_BIT_COUNT;
+
+        return word < words_.size() && ((words_[word] >> (ordinal % WORD_BIT_COUNT)) & 1u) != 0u;
+    }
+
+    size_t GetMemoryUsage() const {
+        return words_.capacity() * sizeof(uint64_t);
+    }
+
+   private:
+    static const size_t WORD_BIT_COUNT = 64;
+
+    std::vector<uint64_t> words_;
+};
@@ -0,0 +1,203 @@
+#include "posting_list.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "bit_packing.h"
+
+void PostingList::Append(uint32_t ordinal, uint32_t term_count, double term_freq) {
+    std::vector<Block>& blocks = blocks_.Edit();
+    if (blocks.empty() || !IsOpen(blocks.size() - 1)) {
+        blocks.push_back({ordinal, ordinal, term_freq, 0, 0, 0, 0});
+    }
+
+    Block& block = blocks.back();
+    block.last_ordinal = ordinal;
+    block.max_term_freq = std::max(block.max_term_freq, term_freq);
+    ++block.size;
+    open_ordinals_.push_back(ordinal);
+    open_term_counts_.push_back(term_count);
+
+    ++size_;
+    max_term_freq_ = std::max(max_term_freq_, term_freq);
+
+    if (open_ordinals_.size() == BLOCK_SIZE) {
+        CloseOpenBlock();
+    }
+}
+
+void PostingList::Erase(uint32_t ordinal) {
+    const size_t block_index = FindBlock(ordinal);
+    if (block_index == blocks_.size()) {
+        return;
+    }
+
+    uint32_t ordinals[BLOCK_SIZE];
+    uint32_t term_counts[BLOCK_SIZE];
+    const size_t block_size = DecodeBlock(block_index, ordinals, term_counts);
+
+    const size_t position = std::lower_bound(ordinals, ordinals + block_size, ordinal) - ordinals;
+    if (position == block_size || ordinals[position] != ordinal) {
+        return;
+    }
+
+    std::copy(ordinals + position + 1, ordinals + block_size, ordinals + position);
+    std::copy(term_counts + position + 1, term_counts + block_size, term_counts + position);
+    --size_;
+
+    const bool is_open = IsOpen(block_index);
+    std::vector<Block>& blocks = blocks_.Edit();
+    Block& block = blocks[block_index];
+    if (is_open) {
+        open_ordinals_.erase(open_ordinals_.begin() + position);
+        open_term_counts_.erase(open_term_counts_.begin() + position);
+    } else {
+        garbage_word_count_ += GetPackedWordCount(block.ordinal_bit_width) + GetPackedWordCount(block.term_count_bit_width);
+    }
+
+    if (--block.size == 0u) {
+        blocks.erase(blocks.begin() + block_index);
+    } else {
+        block.first_ordinal = ordinals[0];
+        block.last_ordinal = ordinals[block.size - 1];
+
+        if (!is_open) {
+            EncodeBlock(block, ordinals, term_counts);
+        }
+    }
+
+    if (garbage_word_count_ * 2 > words_.size()) {
+        CollectGarbage();
+    }
+}
+
+bool PostingList::Contains(uint32_t ordinal) const {
+    const size_t block_index = FindBlock(ordinal);
+    if (block_index == blocks_.size() || blocks_[block_index].first_ordinal > ordinal) {
+        return false;
+    }
+
+    uint32_t ordinals[BLOCK_SIZE];
+    uint32_t term_counts[BLOCK_SIZE];
+    const size_t block_size = DecodeBlock(block_index, ordinals, term_counts);
+
+    return std::binary_search(ordinals, ordinals + block_size, ordinal);
+}
+
+size_t PostingList::DecodeBlock(size_t block_index, uint32_t* ordinals, uint32_t* term_counts) const {
+    const Block& block = blocks_[block_index];
+
+    if (IsOpen(block_index)) {
+        std::copy(open_ordinals_.begin(), open_ordinals_.end(), ordinals);
+        std::copy(open_term_counts_.begin(), open_term_counts_.end(), term_counts);
+
+        return block.size;
+    }
+
+    const uint32_t* words = words_.data() + block.offset;
+    UnpackBits(words, block.ordinal_bit_width, ordinals);
+    RestoreFromDeltas(ordinals, block.first_ordinal);
+
+    UnpackBits(words + GetPackedWordCount(block.ordinal_bit_width), block.term_count_bit_width, term_counts);
+    // counts are stored decremented, as they are never zero
+    for (size_t i = 0; i < BLOCK_SIZE; ++i) {
+        ++term_counts[i];
+    }
+
+    return block.size;
+}
+
+size_t PostingList::GetMemoryUsage() const {
+    return sizeof(*this) + blocks_.GetMemoryUsage() + words_.GetMemoryUsage() +
+           (open_ordinals_.capacity() + open_term_counts_.capacity()) * sizeof(uint32_t);
+}
+
+void PostingList::Save(IndexWriter& writer) const {
+    // the open block is packed too, so the loaded list is mapped as a whole
+    PostingList packed = *this;
+    if (!packed.open_ordinals_.empty()) {
+        packed.CloseOpenBlock();
+    }
+    if (packed.garbage_word_count_ > 0u) {
+        packed.CollectGarbage();
+    }
+
+    writer.WriteValue<uint64_t>(size_);
+    writer.WriteValue(max_term_freq_);
+    writer.WriteArray(packed.blocks_);
+    writer.WriteArray(packed.words_);
+}
+
+PostingList PostingList::Load(IndexReader& reader) {
+    PostingList postings;
+    postings.size_ = reader.ReadValue<uint64_t>();
+    postings.max_term_freq_ = reader.ReadValue<double>();
+    postings.blocks_ = reader.ReadArray<Block>();
+    postings.words_ = reader.ReadArray<uint32_t>();
+
+    return postings;
+}
+
+bool PostingList::IsOpen(size_t block) const {
+    return block + 1 == blocks_.size() && !open_ordinals_.empty();
+}
+
+// the first block which last ordinal isn't less than the given one
+size_t PostingList::FindBlock(uint32_t ordinal) const {
+    auto it = std::lower_bound(blocks_.begin(), blocks_.end(), ordinal, [](const Block& block, uint32_t value) {
+        return block.last_ordinal < value;
+    });
+
+    return it - blocks_.begin();
+}
+
+// packs the block to the end of words_; ordinals and term_counts hold block.size values
+void PostingList::EncodeBlock(Block& block, const uint32_t* ordinals, const uint32_t* term_counts) {
+    uint32_t deltas[BLOCK_SIZE] = {};
+    uint32_t stored_term_counts[BLOCK_SIZE] = {};
+
+    for (size_t i = 0; i < block.size; ++i) {
+        deltas[i] = i == 0u ? 0u : ordinals[i] - ordinals[i - 1];
+        stored_term_counts[i] = term_counts[i] - 1;
+    }
+
+    block.ordinal_bit_width = ComputeBitWidth(deltas, block.size);
+    block.term_count_bit_width = ComputeBitWidth(stored_term_counts, block.size);
+    block.offset = static_cast<uint32_t>(words_.size());
+
+    const size_t ordinal_word_count = GetPackedWordCount(block.ordinal_bit_width);
+    std::vector<uint32_t>& words = words_.Edit();
+    words.resize(words.size() + ordinal_word_count + GetPackedWordCount(block.term_count_bit_width));
+    PackBits(deltas, block.ordinal_bit_width, words.data() + block.offset);
+    PackBits(stored_term_counts, block.term_count_bit_width, words.data() + block.offset + ordinal_word_count);
+}
+
+void PostingList::CloseOpenBlock() {
+    EncodeBlock(blocks_.Edit().back(), open_ordinals_.data(), open_term_counts_.data());
+    open_ordinals_.clear();
+    open_term_counts_.clear();
+}
+
+void PostingList::CollectGarbage() {
+    std::vector<uint32_t> words;
+    words.reserve(words_.size() - garbage_word_count_);
+
+    std::vector<Block>& blocks = blocks_.Edit();
+    for (size_t i = 0; i < blocks.size(); ++i) {
+        if (IsOpen(i)) {
+            continue;
+        }
+
+        Block& block = blocks[i];
+        const size_t word_count = GetPackedWordCount(block.ordinal_bit_width) + GetPackedWordCount(block.term_count_bit_width);
+        const uint32_t offset = static_cast<uint32_t>(words.size());
+
+        words.insert(words.end(), words_.begin() + block.offset, words_.begin() + block.offset + word_count);
+        block.offset = offset;
+    }
+
+    words_.Edit() = std::move(words);
+    garbage_word_count_ = 0;
+}
@@ -0,0 +1,155 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "bit_packing.h"
+#include "index_file.h"
+#include "mappable_vector.h"
+
+// Sorted list of (ordinal, term count) postings. Ordinals are dense internal document numbers given
+// in the order of adding, so appending to the end of a posting list keeps it sorted.
+//
+// Postings are grouped by blocks of at most BLOCK_SIZE. A block is compressed once it gets full:
+// ordinals are stored as deltas from the block's first ordinal and bit-packed together with term
+// counts, erasing re-encodes a single block. The last block stays plain while it isn't full to make
+// appending cheap. Every block remembers its last ordinal and its maximal term frequency, which
+// allows skipping whole blocks and bounding scores without decoding them
+class PostingList {
+   public:
+    static const size_t BLOCK_SIZE = BIT_PACKING_BLOCK_SIZE;
+
+    class Cursor;
+
+    // ordinal must be greater than all the present ones
+    void Append(uint32_t ordinal, uint32_t term_count, double term_freq);
+    void Erase(uint32_t ordinal);
+
+    bool Contains(uint32_t ordinal) const;
+
+    size_t GetSize() const {
+        return size_;
+    }
+
+    double GetMaxTermFreq() const {
+        return max_term_freq_;
+    }
+
+    size_t GetBlockCount() const {
+        return blocks_.size();
+    }
+
+    // ordinals and term_counts must have room for BLOCK_SIZE values; returns the block size
+    size_t DecodeBlock(size_t block, uint32_t* ordinals, uint32_t* term_counts) const;
+
+    size_t GetMemoryUsage() const;
+
+    void Save(IndexWriter& writer) const;
+    // refers to the reader's file data without copying
+    static PostingList Load(IndexReader& reader);
+
+   private:
+    struct Block {
+        uint32_t first_ordinal;
+        uint32_t last_ordinal;
+        // stays an upper bound after erasing
+        double max_term_freq;
+        uint32_t offset;
+        uint8_t size;
+        uint8_t ordinal_bit_width;
+        uint8_t term_count_bit_width;
+    };
+
+    MappableVector<Block> blocks_;
+    // packed blocks one after another, there can be garbage left by erasing
+    MappableVector<uint32_t> words_;
+    size_t garbage_word_count_ = 0;
+    // the last block while it isn't full
+    std::vector<uint32_t> open_ordinals_;
+    std::vector<uint32_t> open_term_counts_;
+    size_t size_ = 0;
+    double max_term_freq_ = 0.0;
+
+    bool IsOpen(size_t block) const;
+    size_t FindBlock(uint32_t ordinal) const;
+    void EncodeBlock(Block& block, const uint32_t* ordinals, const uint32_t* term_counts);
+    void CloseOpenBlock();
+    void CollectGarbage();
+};
+
+// Forward-only iterator for document-at-a-time traversal, decodes one block at a time
+class PostingList::Cursor {
+   public:
+    explicit Cursor(const PostingList& postings) : postings_(&postings) {
+        Load();
+    }
+
+    bool IsEnd() const {
+        return block_ == postings_->blocks_.size();
+    }
+
+    uint32_t GetOrdinal() const {
+        return ordinals_[position_];
+    }
+
+    uint32_t GetTermCount() const {
+        return term_counts_[position_];
+    }
+
+    void Next() {
+        if (++position_ == block_size_) {
+            ++block_;
+            Load();
+        }
+    }
+
+    // moves to the block which may contain the ordinal without decoding it; returns the maximal
+    // term frequency of that block or 0.0 if the ordinal is beyond the list. The cursor must be
+    // moved by Seek before reading postings again
+    double SeekBlock(uint32_t ordinal) {
+        const MappableVector<Block>& blocks = postings_->blocks_;
+
+        while (block_ < blocks.size() && blocks[block_].last_ordinal < ordinal) {
+            ++block_;
+        }
+
+        return block_ < blocks.size() ? blocks[block_].max_term_freq : 0.0;
+    }
+
+    // moves to the first posting with an ordinal not less than the given one
+    void Seek(uint32_t ordinal) {
+        if (IsEnd() || (decoded_block_ == block_ && GetOrdinal() >= ordinal)) {
+            return;
+        }
+
+        SeekBlock(ordinal);
+        if (decoded_block_ != block_) {
+            Load();
+        }
+        if (IsEnd()) {
+            return;
+        }
+
+        while (GetOrdinal() < ordinal) {
+            ++position_;
+        }
+    }
+
+   private:
+    const PostingList* postings_;
+    size_t block_ = 0;
+    size_t decoded_block_ = SIZE_MAX;
+    size_t block_size_ = 0;
+    size_t position_ = 0;
+    uint32_t ordinals_[BLOCK_SIZE];
+    uint32_t term_counts_[BLOCK_SIZE];
+
+    void Load() {
+        position_ = 0;
+
+        if (!IsEnd()) {
+            block_size_ = postings_->DecodeBlock(block_, ordinals_, term_counts_);
+            decoded_block_ = block_;
+        }
+    }
+};
@@ -1,37 +1,135 @@
 #include "process_queries.h"
 
-#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
 #include <execution>
+#include <functional>
 #include <iterator>
+#include <map>
+#include <mutex>
+#include <stdexcept>
 #include <string>
+#include <utility>
 #include <vector>
 
+#include "../helpers/thread_pool/thread_pool.h"
 #include "document.h"
 #include "search_server.h"
 
-std::vector<std::vector<Document>> ProcessQueries(const SearchServer& search_server, const std::vector<std::string>& queries) {
-    std::vector<std::vector<Document>> documents(queries.size());
-
-    std::transform(
-        std::execution::par,
-        queries.begin(), queries.end(),
-        documents.begin(),
-        [&search_server](const std::string& query) {
-            return search_server.FindTopDocuments(query);
-        });
+using namespace std::string_literals;
 
-    return documents;
+std::vector<std::vector<Document>> ProcessQueries(const SearchServer& search_server, const std::vector<std::string>& queries) {
+    // queries sharing terms read their posting lists together
+    return search_server.FindTopDocumentsInBatch(std::execution::par, queries);
 }
 
 std::vector<Document> ProcessQueriesJoined(const SearchServer& search_server, const std::vector<std::string>& queries) {
-    auto documents = ProcessQueries(search_server, queries);
     std::vector<Document> joined_documents;
 
-    for (auto& doc : documents) {
+    // documents are moved here as soon as their turn comes, with no vector of all the results
+    ProcessQueriesStreaming(search_server, queries.begin(), queries.end(), [&joined_documents](size_t, std::vector<Document> documents) {
         joined_documents.insert(
             joined_documents.end(),
-            std::make_move_iterator(doc.begin()), std::make_move_iterator(doc.end()));
-    }
+            std::make_move_iterator(documents.begin()), std::make_move_iterator(documents.end()));
+    });
 
     return joined_documents;
 }
+
+void ProcessQueriesStreaming(const SearchServer& search_server, const std::function<bool(std::string&)>& next_query,
+                             const std::function<void(size_t, std::vector<Document>)>& on_result,
+                             ResultOrder order, size_t worker_count) {
+    if (worker_count == 0) {
+        throw std::invalid_argument("Worker count must be positive"s);
+    }
+
+    struct QueryResult {
+        size_t query_index;
+        std::vector<Document> documents;
+        std::exception_ptr exception;
+    };
+
+    std::mutex mutex;
+    std::condition_variable condition;
+    std::vector<QueryResult> done_results;
+
+    // the pool is destroyed first, so the queries left running when an exception leaves
+    // still have somewhere to put their results
+    ThreadPool thread_pool(worker_count);
+    const size_t max_in_flight = worker_count * QUERIES_IN_FLIGHT_PER_WORKER;
+
+    // results which came before their turn in AS_QUERIED order
+    std::map<size_t, QueryResult> early_results;
+    std::vector<QueryResult> taken_results;
+    size_t next_index = 0;
+    size_t next_given_index = 0;
+    size_t in_flight = 0;  // taken queries whose results aren't given yet
+    bool has_queries = true;
+    std::string query;
+
+    const auto give = [&](QueryResult& result) {
+        --in_flight;
+        if (result.exception) {
+            std::rethrow_exception(result.exception);
+        }
+
+        on_result(result.query_index, std::move(result.documents));
+    };
+
+    while (true) {
+        while (has_queries && in_flight < max_in_flight) {
+            if (!next_query(query)) {
+                has_queries = false;
+                break;
+            }
+
+            thread_pool.Submit([&search_server, &mutex, &condition, &done_results, query_index = next_index, query = std::move(query)]() {
+                QueryResult result{query_index, {}, nullptr};
+                try {
+                    result.documents = search_server.FindTopDocuments(std::execution::seq, query);
+                } catch (...) {
+                    result.exception = std::current_exception();
+                }
+
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    done_results.push_back(std::move(result));
+                }
+                condition.notify_one();
+            });
+
+            query.clear();
+            ++next_index;
+            ++in_flight;
+        }
+
+        if (in_flight == 0) {
+            break;
+        }
+
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            condition.wait(lock, [&done_results]() {
+                return !done_results.empty();
+            });
+
+            taken_results.clear();
+            taken_results.swap(done_results);
+        }
+
+        for (QueryResult& result : taken_results) {
+            if (order == ResultOrder::AS_FOUND) {
+                give(result);
+                continue;
+            }
+
+            early_results.emplace(result.query_index, std::move(result));
+            for (auto it = early_results.begin(); it != early_results.end() && it->first == next_given_index;
+                 it = early_results.erase(it)) {
+                ++next_given_index;
+                give(it->second);
+            }
+        }
+    }
+}
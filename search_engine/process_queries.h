@@ -1,6 +1,10 @@
 #pragma once
 
+#include <algorithm>
+#include <cstddef>
+#include <functional>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include "document.h"
@@ -9,3 +13,44 @@
 std::vector<std::vector<Document>> ProcessQueries(const SearchServer& search_server, const std::vector<std::string>& queries);
 
 std::vector<Document> ProcessQueriesJoined(const SearchServer& search_server, const std::vector<std::string>& queries);
+
+enum class ResultOrder {
+    AS_QUERIED,  // a result waits for the results of all the queries taken before its query
+    AS_FOUND     // a result is given as soon as its query is done
+};
+
+// a worker has that many queries taken ahead of it at most
+const size_t QUERIES_IN_FLIGHT_PER_WORKER = 4;
+
+// Finds the top documents of every query next_query gives on worker_count threads. next_query
+// puts the next query into its argument and returns false when there are no more, on_result gets
+// the query's index and its documents. Both are called in the calling thread only. Queries are
+// taken only as results are given, so the memory used doesn't depend on the number of queries.
+// An exception thrown by a query or by on_result stops taking queries and leaves the function
+// after the started queries are done, in AS_QUERIED order the results before it are all given
+void ProcessQueriesStreaming(const SearchServer& search_server, const std::function<bool(std::string&)>& next_query,
+                             const std::function<void(size_t, std::vector<Document>)>& on_result,
+                             ResultOrder order = ResultOrder::AS_QUERIED,
+                             size_t worker_count = std::max(std::thread::hardware_concurrency(), 1u));
+
+// the queries are taken from [first, last), which may be an input range
+template <typename InputIt, typename ResultSink>
+void ProcessQueriesStreaming(const SearchServer& search_server, InputIt first, InputIt last, ResultSink on_result,
+                             ResultOrder order = ResultOrder::AS_QUERIED,
+                             size_t worker_count = std::max(std::thread::hardware_concurrency(), 1u));
+
+template <typename InputIt, typename ResultSink>
+void ProcessQueriesStreaming(const SearchServer& search_server, InputIt first, InputIt last, ResultSink on_result,
+                             ResultOrder order, size_t worker_count) {
+    const auto next_query = [&first, &last](std::string& query) {
+        if (first == last) {
+            return false;
+        }
+
+        query = *first;
+        ++first;
+        return true;
+    };
+
+    ProcessQueriesStreaming(search_server, next_query, on_result, order, worker_count);
+}
@@ -0,0 +1,119 @@
+#include "query_cache.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "document.h"
+#include "term_dictionary.h"
+
+namespace {
+
+// a list node and a hash table node with the key's copy, roughly
+const size_t ENTRY_OVERHEAD_BYTE_COUNT = 128;
+
+void CombineHash(size_t& hash, size_t value) {
+    hash ^= value + 0x9e3779b97f4a7c15 + (hash << 6) + (hash >> 2);
+}
+
+}  // namespace
+
+bool QueryCacheKey::operator==(const QueryCacheKey& other) const {
+    return plus_term_ids == other.plus_term_ids && plus_edit_distances == other.plus_edit_distances &&
+           minus_term_ids == other.minus_term_ids && comparator_kind == other.comparator_kind &&
+           comparator_value == other.comparator_value;
+}
+
+size_t QueryCacheKeyHasher::operator()(const QueryCacheKey& key) const {
+    size_t hash = std::hash<int>{}(key.comparator_kind * 31 + key.comparator_value);
+
+    for (const TermId term_id : key.plus_term_ids) {
+        CombineHash(hash, term_id);
+    }
+    for (const uint8_t edit_distance : key.plus_edit_distances) {
+        CombineHash(hash, edit_distance);
+    }
+    // minus terms are told apart from plus ones by the separator
+    CombineHash(hash, NO_TERM);
+    for (const TermId term_id : key.minus_term_ids) {
+        CombineHash(hash, term_id);
+    }
+
+    return hash;
+}
+
+double QueryCacheStatistics::GetHitRatio() const {
+    const size_t lookup_count = hit_count + miss_count;
+
+    return lookup_count == 0 ? 0.0 : static_cast<double>(hit_count) / lookup_count;
+}
+
+QueryCache::QueryCache(size_t max_byte_count, size_t shard_count)
+    : max_byte_count_(max_byte_count), shard_count_(shard_count), results_(max_byte_count, shard_count) {
+}
+
+bool QueryCache::Find(const QueryCacheKey& key, uint64_t epoch, std::vector<Document>& documents) {
+    Result result;
+
+    if (!results_.Get(key, result) || result.epoch != epoch) {
+        ++miss_count_;
+        return false;
+    }
+
+    ++hit_count_;
+    documents = std::move(result.documents);
+    return true;
+}
+
+void QueryCache::Insert(const QueryCacheKey& key, uint64_t epoch, const std::vector<Document>& documents) {
+    // the key is kept twice, in the list and in the hash table
+    const size_t byte_count = ENTRY_OVERHEAD_BYTE_COUNT +
+                              2 * (key.plus_term_ids.size() + key.minus_term_ids.size()) * sizeof(TermId) +
+                              2 * key.plus_edit_distances.size() +
+                              documents.size() * sizeof(Document);
+
+    // a result of an older epoch is replaced, so it doesn't wait for eviction
+    results_.Put(key, {epoch, documents}, byte_count);
+}
+
+QueryCacheStatistics QueryCache::GetStatistics() const {
+    QueryCacheStatistics statistics;
+    statistics.hit_count = hit_count_;
+    statistics.miss_count = miss_count_;
+    statistics.entry_count = results_.GetSize();
+    statistics.byte_count = results_.GetByteCount();
+
+    return statistics;
+}
+
+size_t QueryCache::GetMaxByteCount() const {
+    return max_byte_count_;
+}
+
+size_t QueryCache::GetShardCount() const {
+    return shard_count_;
+}
+
+QueryCachePtr::QueryCachePtr(std::unique_ptr<QueryCache> cache) : cache_(std::move(cache)) {
+}
+
+QueryCachePtr::QueryCachePtr(const QueryCachePtr& other) {
+    if (other.cache_ != nullptr) {
+        cache_ = std::make_unique<QueryCache>(other.cache_->GetMaxByteCount(), other.cache_->GetShardCount());
+    }
+}
+
+QueryCachePtr& QueryCachePtr::operator=(const QueryCachePtr& other) {
+    if (this != &other) {
+        *this = QueryCachePtr(other);
+    }
+
+    return *this;
+}
+
+QueryCache* QueryCachePtr::Get() const {
+    return cache_.get();
+}
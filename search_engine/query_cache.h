@@ -0,0 +1,82 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "../helpers/lru_cache/lru_cache.h"
+#include "document.h"
+#include "term_dictionary.h"
+
+// Query as its result depends on it: queries differing only in word order, repeated words,
+// stop words and words absent from the index have the same key
+struct QueryCacheKey {
+    std::vector<TermId> plus_term_ids;  // sorted and without repeats
+    // of plus_term_ids, empty when every term is a word of the query rather than a similar one
+    std::vector<uint8_t> plus_edit_distances;
+    std::vector<TermId> minus_term_ids;
+    // which of the indexed comparators filtered documents, and its value
+    int8_t comparator_kind;
+    int comparator_value;
+
+    bool operator==(const QueryCacheKey& other) const;
+};
+
+struct QueryCacheKeyHasher {
+    size_t operator()(const QueryCacheKey& key) const;
+};
+
+struct QueryCacheStatistics {
+    size_t hit_count = 0;
+    size_t miss_count = 0;
+    size_t entry_count = 0;
+    size_t byte_count = 0;  // keys, results and bookkeeping of the entries
+
+    double GetHitRatio() const;
+};
+
+// Tops of recent queries. Every result is kept with the epoch of the index it was found in, and
+// a result of another epoch is a miss, so changing the index invalidates the cache at no cost
+class QueryCache {
+   public:
+    QueryCache(size_t max_byte_count, size_t shard_count);
+
+    bool Find(const QueryCacheKey& key, uint64_t epoch, std::vector<Document>& documents);
+    void Insert(const QueryCacheKey& key, uint64_t epoch, const std::vector<Document>& documents);
+
+    QueryCacheStatistics GetStatistics() const;
+
+    size_t GetMaxByteCount() const;
+    size_t GetShardCount() const;
+
+   private:
+    struct Result {
+        uint64_t epoch;
+        std::vector<Document> documents;
+    };
+
+    size_t max_byte_count_;
+    size_t shard_count_;
+    LruCache<QueryCacheKey, Result, QueryCacheKeyHasher> results_;
+    std::atomic<size_t> hit_count_ = 0;
+    std::atomic<size_t> miss_count_ = 0;
+};
+
+// The cache of a server, null while it's disabled. Epochs of different servers can be equal, so results
+// mustn't be shared: a copied server gets an empty cache of the same size
+class QueryCachePtr {
+   public:
+    QueryCachePtr() = default;
+    explicit QueryCachePtr(std::unique_ptr<QueryCache> cache);
+
+    QueryCachePtr(const QueryCachePtr& other);
+    QueryCachePtr& operator=(const QueryCachePtr& other);
+    QueryCachePtr(QueryCachePtr&& other) = default;
+    QueryCachePtr& operator=(QueryCachePtr&& other) = default;
+
+    QueryCache* Get() const;
+
+   private:
+    std::unique_ptr<QueryCache> cache_;
+};
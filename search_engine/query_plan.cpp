@@ -0,0 +1,63 @@
+#include "query_plan.h"
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace {
+
+void PrintTerms(std::ostream& os, const std::vector<PlannedTerm>& terms) {
+    using namespace std::string_literals;
+
+    for (const PlannedTerm& term : terms) {
+        os << " "s << term.word << " ("s << term.posting_count << ")"s;
+    }
+}
+
+}  // namespace
+
+std::ostream& operator<<(std::ostream& os, ScoringStrategy scoring) {
+    using namespace std::string_literals;
+
+    switch (scoring) {
+        case ScoringStrategy::TERM_AT_A_TIME:
+            return os << "term-at-a-time"s;
+        case ScoringStrategy::DOCUMENT_AT_A_TIME:
+            return os << "document-at-a-time"s;
+    }
+
+    return os;
+}
+
+std::ostream& operator<<(std::ostream& os, ExclusionStrategy exclusion) {
+    using namespace std::string_literals;
+
+    switch (exclusion) {
+        case ExclusionStrategy::NONE:
+            return os << "none"s;
+        case ExclusionStrategy::BEFORE_SCORING:
+            return os << "before scoring"s;
+        case ExclusionStrategy::CANDIDATE_LOOKUP:
+            return os << "candidate lookup"s;
+    }
+
+    return os;
+}
+
+std::ostream& operator<<(std::ostream& os, const QueryPlan& plan) {
+    using namespace std::string_literals;
+
+    os << "scoring: "s << plan.scoring << ", workers: "s << plan.worker_count
+       << ", exclusion: "s << plan.exclusion << ", estimated cost: "s << plan.estimated_cost << "\n"s;
+
+    os << "plus:"s;
+    PrintTerms(os, plan.plus_terms);
+    os << "\nminus:"s;
+    PrintTerms(os, plan.minus_terms);
+    os << "\nskipped:"s;
+    for (const std::string& word : plan.skipped_words) {
+        os << " "s << word;
+    }
+
+    return os;
+}
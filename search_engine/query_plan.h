@@ -0,0 +1,37 @@
+#pragma once
+#include <cstddef>
+#include <iostream>
+#include <string>
+#include <vector>
+
+enum class ScoringStrategy {
+    TERM_AT_A_TIME,     // postings of one term after another into a dense accumulator
+    DOCUMENT_AT_A_TIME  // postings of all the terms in ordinal order, with top-k pruning
+};
+
+enum class ExclusionStrategy {
+    NONE,             // no minus words in the index
+    BEFORE_SCORING,   // documents of minus words are collected into a bitmap and never scored
+    CANDIDATE_LOOKUP  // every candidate's terms are looked up in the forward index
+};
+
+struct PlannedTerm {
+    std::string word;
+    size_t posting_count;
+};
+
+// How FindTopDocuments evaluates a query. The cost is an estimate in posting reads,
+// it's only good for comparing plans of an index with each other
+struct QueryPlan {
+    std::vector<PlannedTerm> plus_terms;  // in the order they are processed in
+    std::vector<PlannedTerm> minus_terms;
+    std::vector<std::string> skipped_words;  // absent from the index, they cost nothing
+    ScoringStrategy scoring = ScoringStrategy::DOCUMENT_AT_A_TIME;
+    ExclusionStrategy exclusion = ExclusionStrategy::NONE;
+    size_t worker_count = 1;
+    double estimated_cost = 0.0;
+};
+
+std::ostream& operator<<(std::ostream& os, ScoringStrategy scoring);
+std::ostream& operator<<(std::ostream& os, ExclusionStrategy exclusion);
+std::ostream& operator<<(std::ostream& os, const QueryPlan& plan);
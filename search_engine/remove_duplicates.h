@@ -3,4 +3,5 @@
 
 #include "search_server.h"
 
-void RemoveDuplicates(SearchServer& search_server);
+// removes duplicates found by SearchServer::FindDuplicates, printing their ids
+void RemoveDuplicates(SearchServer& search_server, double min_similarity = 1.0);
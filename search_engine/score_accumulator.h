@@ -0,0 +1,120 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Dense relevance accumulator indexed by document ordinal. It remembers touched ordinals,
+// so matched documents can be listed and cleared without scanning the whole array. Rejected
+// ordinals are remembered too, so a comparator is called once per document of a query
+class ScoreAccumulator {
+   public:
+    explicit ScoreAccumulator(size_t ordinal_count = 0) : scores_(ordinal_count, 0.0), matched_(ordinal_count, NOT_MATCHED) {}
+
+    void Add(uint32_t ordinal, double value) {
+        if (matched_[ordinal] != MATCHED) {
+            matched_[ordinal] = MATCHED;
+            touched_.push_back(ordinal);
+        }
+
+        scores_[ordinal] += value;
+    }
+
+    // the ordinal mustn't be matched
+    void Reject(uint32_t ordinal) {
+        matched_[ordinal] = REJECTED;
+        touched_.push_back(ordinal);
+    }
+
+    // clears the touched ordinals only, so reusing an accumulator costs as much as the previous query did
+    void Reset(size_t ordinal_count) {
+        for (const uint32_t ordinal : touched_) {
+            scores_[ordinal] = 0.0;
+            matched_[ordinal] = NOT_MATCHED;
+        }
+        touched_.clear();
+
+        scores_.resize(ordinal_count, 0.0);
+        matched_.resize(ordinal_count, NOT_MATCHED);
+    }
+
+    bool IsMatched(uint32_t ordinal) const {
+        return matched_[ordinal] == MATCHED;
+    }
+
+    bool IsRejected(uint32_t ordinal) const {
+        return matched_[ordinal] == REJECTED;
+    }
+
+    double GetScore(uint32_t ordinal) const {
+        return scores_[ordinal];
+    }
+
+    // matched and rejected ordinals
+    const std::vector<uint32_t>& GetTouched() const {
+        return touched_;
+    }
+
+    size_t GetOrdinalCount() const {
+        return scores_.size();
+    }
+
+   private:
+    static constexpr uint8_t NOT_MATCHED = 0;
+    static constexpr uint8_t MATCHED = 1;
+    static constexpr uint8_t REJECTED = 2;
+
+    std::vector<double> scores_;
+    std::vector<uint8_t> matched_;
+    std::vector<uint32_t> touched_;
+};
+
+// Relevance accumulators of a few queries at once. Scores of an ordinal for all the queries lie side
+// by side, so a posting list scored for several queries touches one cache line per posting
+class BatchScoreAccumulator {
+   public:
+    static const size_t MAX_QUERY_COUNT = 16;
+
+    // clears the touched ordinals only, like ScoreAccumulator::Reset does
+    void Reset(size_t ordinal_count, size_t query_count) {
+        for (const uint32_t ordinal : touched_) {
+            std::fill_n(scores_.begin() + ordinal * query_count_, query_count_, 0.0);
+            matched_[ordinal] = 0;
+        }
+        touched_.clear();
+
+        query_count_ = query_count;
+        scores_.resize(ordinal_count * query_count, 0.0);
+        matched_.resize(ordinal_count, 0);
+    }
+
+    void Add(uint32_t ordinal, size_t query, double value) {
+        uint16_t& matched_queries = matched_[ordinal];
+
+        if (matched_queries == 0u) {
+            touched_.push_back(ordinal);
+        }
+        matched_queries |= static_cast<uint16_t>(1u << query);
+
+        scores_[ordinal * query_count_ + query] += value;
+    }
+
+    bool IsMatched(uint32_t ordinal, size_t query) const {
+        return ((matched_[ordinal] >> query) & 1u) != 0u;
+    }
+
+    double GetScore(uint32_t ordinal, size_t query) const {
+        return scores_[ordinal * query_count_ + query];
+    }
+
+    // ordinals matched by any of the queries
+    const std::vector<uint32_t>& GetTouched() const {
+        return touched_;
+    }
+
+   private:
+    size_t query_count_ = 0;
+    std::vector<double> scores_;
+    std::vector<uint16_t> matched_;  // a bit per query
+    std::vector<uint32_t> touched_;
+};
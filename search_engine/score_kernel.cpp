@@ -0,0 +1,134 @@
+#include "score_kernel.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// AVX2 code is compiled for its own functions only, and runs if the processor turns out to have it
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SCORE_KERNEL_HAS_AVX2
+#include <immintrin.h>
+#endif
+
+namespace {
+
+using ScoreFunction = void (*)(const uint32_t*, const uint32_t*, size_t, const double*, double, double*);
+
+void ComputeScoresScalar(const uint32_t* ordinals, const uint32_t* term_counts, size_t count, const double* inv_word_counts,
+                         double inverse_document_freq, double* scores) {
+    for (size_t i = 0; i < count; ++i) {
+        scores[i] = term_counts[i] * inv_word_counts[ordinals[i]] * inverse_document_freq;
+    }
+}
+
+#if defined(__SSE2__)
+
+void ComputeScoresSse2(const uint32_t* ordinals, const uint32_t* term_counts, size_t count, const double* inv_word_counts,
+                       double inverse_document_freq, double* scores) {
+    const __m128d inverse_document_freqs = _mm_set1_pd(inverse_document_freq);
+    size_t i = 0;
+
+    // SSE2 has no gather, word counts are loaded one by one
+    for (; i + 2 <= count; i += 2) {
+        const __m128d counts = _mm_cvtepi32_pd(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(term_counts + i)));
+        const __m128d inv_counts = _mm_set_pd(inv_word_counts[ordinals[i + 1]], inv_word_counts[ordinals[i]]);
+
+        _mm_storeu_pd(scores + i, _mm_mul_pd(_mm_mul_pd(counts, inv_counts), inverse_document_freqs));
+    }
+
+    ComputeScoresScalar(ordinals + i, term_counts + i, count - i, inv_word_counts, inverse_document_freq, scores + i);
+}
+
+#endif
+
+#if defined(SCORE_KERNEL_HAS_AVX2)
+
+__attribute__((target("avx2"))) void ComputeScoresAvx2(const uint32_t* ordinals, const uint32_t* term_counts, size_t count,
+                                                       const double* inv_word_counts, double inverse_document_freq,
+                                                       double* scores) {
+    const __m256d inverse_document_freqs = _mm256_set1_pd(inverse_document_freq);
+    // the masked gather takes every lane, and unlike the plain one starts from defined values
+    const __m256d all_lanes = _mm256_castsi256_pd(_mm256_set1_epi64x(-1));
+    size_t i = 0;
+
+    for (; i + 4 <= count; i += 4) {
+        const __m256d counts = _mm256_cvtepi32_pd(_mm_loadu_si128(reinterpret_cast<const __m128i*>(term_counts + i)));
+        const __m128i indexes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ordinals + i));
+        const __m256d inv_counts = _mm256_mask_i32gather_pd(_mm256_setzero_pd(), inv_word_counts, indexes, all_lanes,
+                                                            sizeof(double));
+
+        _mm256_storeu_pd(scores + i, _mm256_mul_pd(_mm256_mul_pd(counts, inv_counts), inverse_document_freqs));
+    }
+
+    ComputeScoresScalar(ordinals + i, term_counts + i, count - i, inv_word_counts, inverse_document_freq, scores + i);
+}
+
+#endif
+
+ScoreFunction GetScoreFunction(ScoreKernel kernel) {
+    using namespace std::string_literals;
+
+    if (!IsScoreKernelSupported(kernel)) {
+        throw std::invalid_argument("The processor doesn't support the score kernel"s);
+    }
+
+    switch (kernel) {
+#if defined(SCORE_KERNEL_HAS_AVX2)
+        case ScoreKernel::AVX2:
+            return ComputeScoresAvx2;
+#endif
+#if defined(__SSE2__)
+        case ScoreKernel::SSE2:
+            return ComputeScoresSse2;
+#endif
+        default:
+            return ComputeScoresScalar;
+    }
+}
+
+}  // namespace
+
+bool IsScoreKernelSupported(ScoreKernel kernel) {
+    switch (kernel) {
+        case ScoreKernel::SCALAR:
+            return true;
+        case ScoreKernel::SSE2:
+#if defined(__SSE2__)
+            return true;
+#else
+            return false;
+#endif
+        case ScoreKernel::AVX2:
+#if defined(SCORE_KERNEL_HAS_AVX2)
+            return __builtin_cpu_supports("avx2");
+#else
+            return false;
+#endif
+    }
+
+    return false;
+}
+
+ScoreKernel GetBestScoreKernel() {
+    static const ScoreKernel best_kernel = IsScoreKernelSupported(ScoreKernel::AVX2)   ? ScoreKernel::AVX2
+                                           : IsScoreKernelSupported(ScoreKernel::SSE2) ? ScoreKernel::SSE2
+                                                                                       : ScoreKernel::SCALAR;
+
+    return best_kernel;
+}
+
+void ComputeScores(const uint32_t* ordinals, const uint32_t* term_counts, size_t count, const double* inv_word_counts,
+                   double inverse_document_freq, double* scores) {
+    static const ScoreFunction best_function = GetScoreFunction(GetBestScoreKernel());
+
+    best_function(ordinals, term_counts, count, inv_word_counts, inverse_document_freq, scores);
+}
+
+void ComputeScores(ScoreKernel kernel, const uint32_t* ordinals, const uint32_t* term_counts, size_t count,
+                   const double* inv_word_counts, double inverse_document_freq, double* scores) {
+    GetScoreFunction(kernel)(ordinals, term_counts, count, inv_word_counts, inverse_document_freq, scores);
+}
@@ -0,0 +1,23 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// Scores of a decoded block of postings: scores[i] = term_counts[i] * inv_word_counts[ordinals[i]] *
+// inverse_document_freq. Every kernel multiplies in this order and in double precision, so all of
+// them give the same scores to the bit. Sums of a document's scores depend on the order of terms
+enum class ScoreKernel {
+    SCALAR,  // the reference the others are checked against
+    SSE2,
+    AVX2,  // gathers word counts of 4 documents at once
+};
+
+bool IsScoreKernelSupported(ScoreKernel kernel);
+// the fastest kernel the processor has, found out once
+ScoreKernel GetBestScoreKernel();
+
+// ordinals and term counts must be below 2^31
+void ComputeScores(const uint32_t* ordinals, const uint32_t* term_counts, size_t count, const double* inv_word_counts,
+                   double inverse_document_freq, double* scores);
+// throws if the processor doesn't support the kernel
+void ComputeScores(ScoreKernel kernel, const uint32_t* ordinals, const uint32_t* term_counts, size_t count,
+                   const double* inv_word_counts, double inverse_document_freq, double* scores);
@@ -0,0 +1,81 @@
+#include "search_cursor.h"
+
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+
+#include "document.h"
+
+using namespace std::string_literals;
+
+namespace {
+
+const char SEPARATOR = '.';
+
+// the whole value, throws otherwise
+template <typename Number>
+Number ParseNumber(std::string_view text, int base) {
+    Number number = 0;
+    const auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), number, base);
+
+    if (error != std::errc() || end != text.data() + text.size()) {
+        throw std::invalid_argument("Malformed search cursor"s);
+    }
+
+    return number;
+}
+
+}  // namespace
+
+SearchCursor::SearchCursor(const Document& last_document) : is_start_(false), last_document_(last_document) {
+}
+
+bool SearchCursor::IsStart() const {
+    return is_start_;
+}
+
+const Document& SearchCursor::GetLastDocument() const {
+    return last_document_;
+}
+
+// "<relevance bits in hex>.<rating>.<id>", the relevance has to be exact to tell the document itself
+// from the ones with the same rounded relevance; the start is an empty string
+std::string SearchCursor::ToString() const {
+    if (is_start_) {
+        return {};
+    }
+
+    uint64_t relevance_bits = 0;
+    std::memcpy(&relevance_bits, &last_document_.relevance, sizeof(relevance_bits));
+
+    char relevance_text[16];
+    char* relevance_end = std::to_chars(relevance_text, relevance_text + sizeof(relevance_text), relevance_bits, 16).ptr;
+
+    return std::string(relevance_text, relevance_end) + SEPARATOR + std::to_string(last_document_.rating) + SEPARATOR +
+           std::to_string(last_document_.id);
+}
+
+SearchCursor SearchCursor::FromString(std::string_view text) {
+    if (text.empty()) {
+        return {};
+    }
+
+    const size_t rating_begin = text.find(SEPARATOR);
+    const size_t id_begin = rating_begin == std::string_view::npos ? rating_begin : text.find(SEPARATOR, rating_begin + 1);
+    if (id_begin == std::string_view::npos) {
+        throw std::invalid_argument("Malformed search cursor"s);
+    }
+
+    const uint64_t relevance_bits = ParseNumber<uint64_t>(text.substr(0, rating_begin), 16);
+    Document last_document;
+    std::memcpy(&last_document.relevance, &relevance_bits, sizeof(relevance_bits));
+    last_document.rating = ParseNumber<int>(text.substr(rating_begin + 1, id_begin - rating_begin - 1), 10);
+    last_document.id = ParseNumber<int>(text.substr(id_begin + 1), 10);
+
+    return SearchCursor(last_document);
+}
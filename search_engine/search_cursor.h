@@ -0,0 +1,32 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "document.h"
+
+// Place in a ranking the next page starts after: relevance, rating and id of the last document of
+// the previous page. A default cursor is the start of the ranking
+class SearchCursor {
+   public:
+    SearchCursor() = default;
+    explicit SearchCursor(const Document& last_document);
+
+    bool IsStart() const;
+    // the cursor mustn't be the start
+    const Document& GetLastDocument() const;
+
+    // text form which can be handed out and taken back, FromString throws on a malformed one
+    std::string ToString() const;
+    static SearchCursor FromString(std::string_view text);
+
+   private:
+    bool is_start_ = true;
+    Document last_document_;
+};
+
+struct SearchPage {
+    std::vector<Document> documents;
+    // after the last document of the page; a page shorter than asked for is the last one
+    SearchCursor next_cursor;
+};
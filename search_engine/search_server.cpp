@@ -1,21 +1,131 @@
 #include "search_server.h"
 
 #include <algorithm>
+#include <chrono>
 #include <cmath>
+#include <cstdint>
 #include <execution>
+#include <map>
+#include <memory>
 #include <set>
 #include <stdexcept>
 #include <string>
 #include <string_view>
 #include <tuple>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
 #include "../helpers/log_duration.h"
+#include "async_query.h"
 #include "document.h"
+#include "index_file.h"
+#include "query_cache.h"
+#include "query_plan.h"
+#include "score_accumulator.h"
+#include "search_cursor.h"
 #include "string_processing.h"
+#include "top_documents.h"
 
 using namespace std::string_literals;
 
+namespace {
+
+// costs of query evaluation steps for planning, a posting read is the unit
+const double RESULT_DOCUMENT_COST = 1.0;     // every document term-at-a-time finds is made and sorted
+const double CURSOR_COMPARISON_COST = 0.25;  // document-at-a-time compares every cursor with every candidate
+const double BITMAP_ADDITION_COST = 0.5;
+const double BITMAP_TEST_COST = 0.1;
+const double FORWARD_LOOKUP_COST = 2.0;  // a binary search among the terms of a document
+const double POSTING_DECODING_COST = 0.3;  // the share of a posting read which queries scored together share
+const double BATCH_SLOT_COST = 0.25;       // a candidate of a group is looked at for every query of the group
+
+// finalizer of splitmix64: every bit of the value affects every bit of the result
+uint64_t MixBits(uint64_t value) {
+    value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9;
+    value = (value ^ (value >> 27)) * 0x94d049bb133111eb;
+    return value ^ (value >> 31);
+}
+
+// Calls on_match for the values of both sorted ranges. Every value of the shorter range is searched
+// in the longer one with exponentially growing steps from the previous match, so the intersection
+// costs O(short * log(long / short)) instead of O(short + long) of a merge
+template <typename Callback>
+void IntersectGalloping(const TermId* begin, const TermId* end, const TermId* other_begin, const TermId* other_end,
+                        Callback on_match) {
+    if (end - begin > other_end - other_begin) {
+        std::swap(begin, other_begin);
+        std::swap(end, other_end);
+    }
+
+    for (; begin != end && other_begin != other_end; ++begin) {
+        const TermId value = *begin;
+        const size_t size = other_end - other_begin;
+
+        size_t bound = 1;
+        while (bound < size && other_begin[bound] < value) {
+            bound *= 2;
+        }
+        other_begin = std::lower_bound(other_begin + bound / 2, other_begin + std::min(bound + 1, size), value);
+
+        if (other_begin != other_end && *other_begin == value) {
+            on_match(value);
+            ++other_begin;
+        }
+    }
+}
+
+// edits a word is matched with: short words with a typo allowed look like too many other words
+int GetWordEditDistance(std::string_view word, int max_edit_distance) {
+    if (TermDictionary::IsPattern(word) || word.size() < 3) {
+        return 0;
+    }
+
+    return std::min(max_edit_distance, word.size() < 6 ? 1 : 2);
+}
+
+// (term, edit distance) of the closest terms, the word's own term among them
+void FindSimilarTerms(const TermDictionary& dictionary, std::string_view word, int edit_distance,
+                      std::vector<std::pair<TermId, int>>& terms) {
+    terms.clear();
+    dictionary.FindSimilar(word, edit_distance, MAX_FUZZY_TERM_COUNT, terms);
+}
+
+std::vector<TermId> GetSortedTermIds(const TermDictionary& dictionary, const std::vector<std::string_view>& words,
+                                     int max_edit_distance = 0) {
+    std::vector<TermId> term_ids;
+    std::vector<std::pair<TermId, int>> similar_terms;
+
+    for (std::string_view word : words) {
+        if (TermDictionary::IsPattern(word)) {
+            dictionary.FindMatching(word, MAX_PATTERN_TERM_COUNT, term_ids);
+            continue;
+        }
+
+        const int edit_distance = GetWordEditDistance(word, max_edit_distance);
+        if (edit_distance > 0) {
+            FindSimilarTerms(dictionary, word, edit_distance, similar_terms);
+            for (const auto& [term_id, _] : similar_terms) {
+                term_ids.push_back(term_id);
+            }
+            continue;
+        }
+
+        const TermId term_id = dictionary.Find(word);
+
+        if (term_id != NO_TERM) {
+            term_ids.push_back(term_id);
+        }
+    }
+    std::sort(term_ids.begin(), term_ids.end());
+    // a term may be matched by several patterns or similar words
+    term_ids.erase(std::unique(term_ids.begin(), term_ids.end()), term_ids.end());
+
+    return term_ids;
+}
+
+}  // namespace
+
 SearchServer::SearchServer() = default;
 
 SearchServer::SearchServer(const std::string& text) : SearchServer(std::string_view(text)) {}
@@ -25,28 +135,49 @@ SearchServer::SearchServer(std::string_view text) : SearchServer(SplitIntoWords(
 void SearchServer::AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings) {
     if (document_id < 0) {
         throw std::invalid_argument("Document id mustn't be negative"s);
-    } else if (document_ratings_status_.count(document_id)) {
+    } else if (id_to_ordinal_.count(document_id)) {
         throw std::invalid_argument("Document with such id has already added"s);
+    } else if (!IsValidStatus(static_cast<int8_t>(status))) {
+        throw std::invalid_argument("Invalid document status"s);
     }
 
-    const std::vector<std::string_view> words = SplitIntoWordsNoStopAndValid(document);
-    const double inv_word_count = 1.0 / words.size();
+    std::vector<std::string_view>& words = words_buffer_;
+    SplitIntoWordsNoStopAndValid(document, words);
 
-    for (const std::string_view word_v : words) {
-        std::string word(word_v);
+    // equal words become neighbours, so every run of them gives one posting
+    std::sort(words.begin(), words.end());
+    std::vector<std::pair<std::string_view, uint32_t>> term_counts;
 
-        word_to_document_freqs_[word][document_id] += inv_word_count;
-        document_to_word_freqs_[document_id][word] += inv_word_count;
+    for (auto it = words.begin(); it != words.end();) {
+        const auto run_end = std::find_if(it, words.end(), [word = *it](std::string_view other) {
+            return other != word;
+        });
+
+        term_counts.emplace_back(*it, static_cast<uint32_t>(run_end - it));
+        it = run_end;
     }
 
-    document_ratings_status_[document_id] = Document(ComputeAverageRating(ratings), status);
-    document_ids_.insert(document_id);
+    AddDocumentTerms(document_id, term_counts, 1.0 / words.size(), Document(ComputeAverageRating(ratings), status));
+}
+
+void SearchServer::CopyDocuments(const SearchServer& other, const DeletionSet& deletions) {
+    CopyDocuments(other, [&other, &deletions](int document_id) {
+        return !deletions.Contains(other.id_to_ordinal_.at(document_id));
+    });
 }
 
 void SearchServer::RemoveDocument(int document_id) {
     RemoveDocument(std::execution::seq, document_id);
 }
 
+void SearchServer::Compact() {
+    Compact(std::execution::seq);
+}
+
+size_t SearchServer::GetTombstoneCount() const {
+    return tombstone_ordinals_.size();
+}
+
 std::vector<Document> SearchServer::FindTopDocuments(std::string_view raw_query) const {
     return FindTopDocuments(std::execution::seq, raw_query);
 }
@@ -55,23 +186,188 @@ std::vector<Document> SearchServer::FindTopDocuments(std::string_view raw_query,
     return FindTopDocuments(std::execution::seq, raw_query, status);
 }
 
+SearchPage SearchServer::FindTopDocuments(std::string_view raw_query, size_t page_size, const SearchCursor& cursor) const {
+    return FindTopDocuments(raw_query, page_size, cursor, ByStatus{DocumentStatus::ACTUAL});
+}
+
+void SearchServer::SetFuzzyMatching(int max_edit_distance) {
+    using namespace std::string_literals;
+
+    if (max_edit_distance < 0 || max_edit_distance > MAX_FUZZY_EDIT_DISTANCE) {
+        throw std::invalid_argument("Edit distance must be from 0 to "s + std::to_string(MAX_FUZZY_EDIT_DISTANCE));
+    }
+
+    max_edit_distance_ = max_edit_distance;
+}
+
+void SearchServer::EnableQueryCache(size_t max_byte_count) {
+    query_cache_ = QueryCachePtr(std::make_unique<QueryCache>(max_byte_count, QUERY_CACHE_SHARD_COUNT));
+}
+
+QueryCacheStatistics SearchServer::GetQueryCacheStatistics() const {
+    return query_cache_.Get() != nullptr ? query_cache_.Get()->GetStatistics() : QueryCacheStatistics{};
+}
+
+QueryHandle SearchServer::FindTopDocumentsAsync(QueryExecutor& executor, std::string_view raw_query,
+                                                std::chrono::steady_clock::time_point deadline) const {
+    return FindTopDocumentsAsync(executor, raw_query, ByStatus{DocumentStatus::ACTUAL}, deadline);
+}
+
+QueryHandle SearchServer::FindTopDocumentsAsync(std::string_view raw_query, std::chrono::steady_clock::time_point deadline) const {
+    return FindTopDocumentsAsync(QueryExecutor::GetShared(), raw_query, deadline);
+}
+
 std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDocument(
     std::string_view raw_query, int document_id) const {
     return MatchDocument(std::execution::seq, raw_query, document_id);
 }
 
+std::vector<std::tuple<std::vector<std::string_view>, DocumentStatus>> SearchServer::MatchDocuments(
+    std::string_view raw_query, const std::vector<int>& document_ids) const {
+    return MatchDocuments(std::execution::seq, raw_query, document_ids);
+}
+
 int SearchServer::GetDocumentCount() const {
-    return document_ratings_status_.size();
+    return static_cast<int>(document_ids_.size());
 }
 
-const std::map<std::string, double>& SearchServer::GetWordFrequencies(int document_id) const {
-    const static std::map<std::string, double> EMPTY_MAP = {};
+QueryPlan SearchServer::ExplainQuery(std::string_view raw_query) const {
+    return ExplainQuery(std::execution::seq, raw_query);
+}
 
-    if (document_to_word_freqs_.count(document_id)) {
-        return document_to_word_freqs_.at(document_id);
+CollectionStatistics SearchServer::GetStatistics(std::string_view raw_query) const {
+    return GetStatistics(raw_query, DeletionSet());
+}
+
+CollectionStatistics SearchServer::GetStatistics(std::string_view raw_query, const DeletionSet& deletions) const {
+    CollectionStatistics statistics;
+    statistics.document_count = GetDocumentCount() - static_cast<int>(deletions.GetDocumentCount());
+    const auto get_document_freq = [this, &deletions](TermId term_id) {
+        return GetDocumentFreq(term_id) - static_cast<int>(deletions.GetPostingCount(term_id));
+    };
+
+    std::vector<TermId> pattern_term_ids;
+    std::vector<std::pair<TermId, int>> similar_terms;
+    for (std::string_view word : ParseQuery(raw_query).plus_words) {
+        const int edit_distance = GetWordEditDistance(word, max_edit_distance_);
+
+        if (TermDictionary::IsPattern(word) || edit_distance > 0) {
+            pattern_term_ids.clear();
+            if (edit_distance > 0) {
+                FindSimilarTerms(dictionary_, word, edit_distance, similar_terms);
+                for (const auto& [term_id, _] : similar_terms) {
+                    pattern_term_ids.push_back(term_id);
+                }
+            } else {
+                dictionary_.FindMatching(word, MAX_PATTERN_TERM_COUNT, pattern_term_ids);
+            }
+
+            for (const TermId term_id : pattern_term_ids) {
+                statistics.document_freqs[std::string(dictionary_.GetTerm(term_id))] = get_document_freq(term_id);
+            }
+            continue;
+        }
+
+        const TermId term_id = dictionary_.Find(word);
+
+        statistics.document_freqs[std::string(word)] = term_id == NO_TERM ? 0 : get_document_freq(term_id);
     }
 
-    return EMPTY_MAP;
+    return statistics;
+}
+
+std::map<std::string_view, double> SearchServer::GetWordFrequencies(int document_id) const {
+    std::map<std::string_view, double> word_freqs;
+
+    if (id_to_ordinal_.count(document_id)) {
+        const uint32_t ordinal = id_to_ordinal_.at(document_id);
+        const auto [begin, end] = GetForwardRange(ordinal);
+
+        for (uint64_t i = begin; i < end; ++i) {
+            word_freqs[dictionary_.GetTerm(forward_term_ids_[i])] = forward_term_counts_[i] * inv_word_counts_[ordinal];
+        }
+    }
+
+    return word_freqs;
+}
+
+void SearchServer::SaveIndex(const std::string& path) const {
+    IndexWriter writer(path);
+
+    std::string stop_words;
+    for (std::string_view word : tokenizer_.GetStopWords()) {
+        stop_words += std::string(word) + " "s;
+    }
+    writer.WriteArray(stop_words);
+
+    dictionary_.Save(writer);
+    writer.WriteValue<uint64_t>(postings_.size());
+    for (const PostingList& postings : postings_) {
+        postings.Save(writer);
+    }
+
+    writer.WriteArray(forward_offsets_);
+    writer.WriteArray(forward_term_ids_);
+    writer.WriteArray(forward_term_counts_);
+    writer.WriteArray(ordinal_to_id_);
+    writer.WriteArray(inv_word_counts_);
+
+    // removed documents keep their ordinals, they are marked by the status
+    writer.WriteArray(ratings_);
+    writer.WriteArray(statuses_);
+    writer.WriteArray(tombstone_ordinals_);
+
+    writer.Finish();
+}
+
+SearchServer SearchServer::OpenIndex(const std::string& path) {
+    auto file = std::make_shared<const MappedFile>(path);
+    IndexReader reader(*file);
+
+    const MappableVector<char> stop_words = reader.ReadArray<char>();
+    SearchServer server(std::string_view(stop_words.data(), stop_words.size()));
+    server.index_file_ = file;
+
+    server.dictionary_ = TermDictionary::Load(reader);
+    server.postings_.resize(reader.ReadValue<uint64_t>());
+    for (PostingList& postings : server.postings_) {
+        postings = PostingList::Load(reader);
+    }
+
+    server.forward_offsets_ = reader.ReadArray<uint64_t>();
+    server.forward_term_ids_ = reader.ReadArray<TermId>();
+    server.forward_term_counts_ = reader.ReadArray<uint32_t>();
+    server.ordinal_to_id_ = reader.ReadArray<int>();
+    server.inv_word_counts_ = reader.ReadArray<double>();
+
+    server.ratings_ = reader.ReadArray<int>();
+    server.statuses_ = reader.ReadArray<int8_t>();
+    if (server.statuses_.size() != server.ordinal_to_id_.size()) {
+        throw std::runtime_error("Index file is corrupt"s);
+    }
+
+    // id lookups are hash and tree based, they are built anew with status bitmaps
+    for (uint32_t ordinal = 0; ordinal < server.ordinal_to_id_.size(); ++ordinal) {
+        const int8_t status = server.statuses_[ordinal];
+        if (status == REMOVED_ORDINAL_STATUS) {
+            continue;
+        }
+        // a status indexes the bitmaps
+        if (!IsValidStatus(status)) {
+            throw std::runtime_error("Index file has an invalid document status"s);
+        }
+
+        const int document_id = server.ordinal_to_id_[ordinal];
+        server.status_bitmaps_[status].Set(ordinal);
+        server.document_ids_.insert(document_id);
+        server.id_to_ordinal_[document_id] = ordinal;
+    }
+
+    for (const uint32_t ordinal : reader.ReadArray<uint32_t>()) {
+        server.AddTombstone(ordinal);
+    }
+
+    return server;
 }
 
 std::set<int>::const_iterator SearchServer::begin() const {
@@ -102,26 +398,142 @@ int SearchServer::ComputeAverageRating(const std::vector<int>& ratings) {
     return rating_sum / static_cast<int>(ratings.size());
 }
 
-bool SearchServer::IsStopWord(std::string_view word) const {
-    return count_if(stop_words_.begin(), stop_words_.end(), [&word](std::string_view word_v) {
-               return word_v == word;
-           }) > 0;
+void SearchServer::SplitIntoWordsNoStopAndValid(std::string_view text, std::vector<std::string_view>& words) const {
+    const std::string_view invalid_word = tokenizer_.Split(text, true, words);
+
+    if (!invalid_word.empty()) {
+        throw std::invalid_argument("Document mustn't include special characters: \""s + std::string(invalid_word) + "\""s);
+    }
 }
 
-std::vector<std::string_view> SearchServer::SplitIntoWordsNoStopAndValid(std::string_view text) const {
-    std::vector<std::string_view> words;
+void SearchServer::AddDocumentTerms(int document_id, const std::vector<std::pair<std::string_view, uint32_t>>& term_counts,
+                                    double inv_word_count, const Document& document_data) {
+    const uint32_t ordinal = static_cast<uint32_t>(ordinal_to_id_.size());
+    std::vector<std::pair<TermId, uint32_t>> forward_terms;
+    forward_terms.reserve(term_counts.size());
+
+    for (const auto& [word, term_count] : term_counts) {
+        const TermId term_id = dictionary_.Insert(word);
+        if (term_id == postings_.size()) {
+            postings_.emplace_back();
+        }
+
+        // the document is the last one added, so its postings go to the ends of the lists
+        postings_[term_id].Append(ordinal, term_count, term_count * inv_word_count);
+        forward_terms.emplace_back(term_id, term_count);
+    }
+
+    std::sort(forward_terms.begin(), forward_terms.end());
+    forward_offsets_.Edit().push_back(forward_term_ids_.size());
+    for (const auto& [term_id, term_count] : forward_terms) {
+        forward_term_ids_.Edit().push_back(term_id);
+        forward_term_counts_.Edit().push_back(term_count);
+    }
+
+    AddDocumentData(document_id, inv_word_count, document_data);
+}
+
+void SearchServer::AddDocumentData(int document_id, double inv_word_count, const Document& document_data) {
+    const uint32_t ordinal = static_cast<uint32_t>(ordinal_to_id_.size());
+
+    document_ids_.insert(document_id);
+    ordinal_to_id_.Edit().push_back(document_id);
+    inv_word_counts_.Edit().push_back(inv_word_count);
+    ratings_.Edit().push_back(document_data.rating);
+    statuses_.Edit().push_back(REMOVED_ORDINAL_STATUS);
+    SetStatus(ordinal, static_cast<int8_t>(document_data.status));
+    id_to_ordinal_[document_id] = ordinal;
+}
+
+bool SearchServer::IsValidStatus(int8_t status) {
+    return status >= 0 && static_cast<size_t>(status) < DOCUMENT_STATUS_COUNT;
+}
+
+void SearchServer::SetStatus(uint32_t ordinal, int8_t status) {
+    // documents are added and removed through here, statuses are checked on adding and opening
+    ++epoch_;
+
+    const int8_t old_status = statuses_[ordinal];
+
+    if (old_status != REMOVED_ORDINAL_STATUS) {
+        status_bitmaps_[old_status].Reset(ordinal);
+    }
+    if (status != REMOVED_ORDINAL_STATUS) {
+        status_bitmaps_[status].Set(ordinal);
+    }
+
+    statuses_.Edit()[ordinal] = status;
+}
+
+void SearchServer::AddTombstone(uint32_t ordinal) {
+    tombstones_.Set(ordinal);
+    tombstone_ordinals_.push_back(ordinal);
+    tombstone_posting_counts_.resize(postings_.size(), 0u);
+
+    const auto [begin, end] = GetForwardRange(ordinal);
+    for (uint64_t i = begin; i < end; ++i) {
+        ++tombstone_posting_counts_[forward_term_ids_[i]];
+    }
+}
+
+PostingList SearchServer::CompactPostings(const PostingList& postings) const {
+    PostingList compacted;
+    uint32_t ordinals[PostingList::BLOCK_SIZE];
+    uint32_t term_counts[PostingList::BLOCK_SIZE];
 
-    for (std::string_view word : SplitIntoWords(text)) {
-        if (HasSpecialCharacters(word)) {
-            throw std::invalid_argument("Document mustn't include special characters: \""s + std::string(word) + "\""s);
+    // the rest of the postings are packed into full blocks with exact block bounds
+    for (size_t block = 0; block < postings.GetBlockCount(); ++block) {
+        const size_t block_size = postings.DecodeBlock(block, ordinals, term_counts);
+
+        for (size_t i = 0; i < block_size; ++i) {
+            if (!tombstones_.Test(ordinals[i])) {
+                compacted.Append(ordinals[i], term_counts[i], term_counts[i] * inv_word_counts_[ordinals[i]]);
+            }
         }
+    }
+
+    return compacted;
+}
+
+Document SearchServer::MakeDocument(uint32_t ordinal, double relevance) const {
+    return Document(ordinal_to_id_[ordinal], relevance, ratings_[ordinal], static_cast<DocumentStatus>(statuses_[ordinal]));
+}
+
+SearchServer::PartialIndex SearchServer::BuildPartialIndex(const std::vector<std::string_view>& texts, size_t begin, size_t end) const {
+    PartialIndex partial_index;
+    partial_index.first_document = begin;
+    std::unordered_map<std::string_view, uint32_t> term_ids;
+    std::vector<std::string_view> words;
+
+    for (size_t document = begin; document < end; ++document) {
+        SplitIntoWordsNoStopAndValid(texts[document], words);
+        const uint32_t part_document = static_cast<uint32_t>(document - begin);
+
+        partial_index.document_offsets.push_back(partial_index.document_terms.size());
+        partial_index.inv_word_counts.push_back(1.0 / words.size());
+
+        std::sort(words.begin(), words.end());
+        for (auto it = words.begin(); it != words.end();) {
+            const auto run_end = std::find_if(it, words.end(), [word = *it](std::string_view other) {
+                return other != word;
+            });
+            const uint32_t term_count = static_cast<uint32_t>(run_end - it);
+
+            const auto [term_id, is_new] = term_ids.emplace(*it, static_cast<uint32_t>(partial_index.terms.size()));
+            if (is_new) {
+                partial_index.terms.push_back(*it);
+                partial_index.postings.emplace_back();
+            }
 
-        if (!IsStopWord(word)) {
-            words.push_back(word);
+            partial_index.postings[term_id->second].emplace_back(part_document, term_count);
+            partial_index.document_terms.emplace_back(term_id->second, term_count);
+
+            it = run_end;
         }
     }
+    partial_index.document_offsets.push_back(partial_index.document_terms.size());
 
-    return words;
+    return partial_index;
 }
 
 SearchServer::QueryWord SearchServer::ParseQueryWord(std::string_view text) const {
@@ -137,35 +549,599 @@ SearchServer::QueryWord SearchServer::ParseQueryWord(std::string_view text) cons
         text.remove_prefix(1);
     }
 
-    if (HasSpecialCharacters(text)) {
-        throw std::invalid_argument("Text mustn't include special characters"s);
-    }
-
     return {
         text,
         is_minus,
-        IsStopWord(text),
+        tokenizer_.IsStopWord(text),
     };
 }
 
-SearchServer::Query SearchServer::ParseQuery(std::string_view text) const {
-    Query query;
+void SearchServer::ParseQuery(std::string_view text, std::vector<std::string_view>& words, Query& query) const {
+    query.plus_words.clear();
+    query.minus_words.clear();
+
+    if (!tokenizer_.Split(text, false, words).empty()) {
+        throw std::invalid_argument("Text mustn't include special characters"s);
+    }
 
-    for (std::string_view word : SplitIntoWords(text)) {
+    for (std::string_view word : words) {
         const QueryWord query_word = ParseQueryWord(word);
 
         if (!query_word.is_stop) {
             if (query_word.is_minus) {
-                query.minus_words.insert(query_word.data);
+                query.minus_words.push_back(query_word.data);
             } else {
-                query.plus_words.insert(query_word.data);
+                query.plus_words.push_back(query_word.data);
             }
         }
     }
+
+    // a query has few words, so sorting a vector is cheaper than building a set
+    for (std::vector<std::string_view>* query_words : {&query.plus_words, &query.minus_words}) {
+        std::sort(query_words->begin(), query_words->end());
+        query_words->erase(std::unique(query_words->begin(), query_words->end()), query_words->end());
+    }
+}
+
+SearchServer::Query SearchServer::ParseQuery(std::string_view text) const {
+    std::vector<std::string_view> words;
+    Query query;
+    ParseQuery(text, words, query);
+
     return query;
 }
 
-// Existence required
-double SearchServer::ComputeWordInverseDocumentFreq(const std::string& word) const {
-    return std::log(document_ratings_status_.size() * 1.0 / word_to_document_freqs_.at(word).size());
+int SearchServer::GetDocumentFreq(TermId term_id) const {
+    const size_t tombstone_count = term_id < tombstone_posting_counts_.size() ? tombstone_posting_counts_[term_id] : 0u;
+
+    return static_cast<int>(postings_[term_id].GetSize() - tombstone_count);
+}
+
+double SearchServer::ComputeWordInverseDocumentFreq(TermId term_id) const {
+    return std::log(GetDocumentCount() * 1.0 / GetDocumentFreq(term_id));
+}
+
+std::pair<uint64_t, uint64_t> SearchServer::GetForwardRange(uint32_t ordinal) const {
+    const uint64_t end = ordinal + 1 < forward_offsets_.size() ? forward_offsets_[ordinal + 1] : forward_term_ids_.size();
+
+    return {forward_offsets_[ordinal], end};
+}
+
+SearchServer::MatchTerms SearchServer::GetMatchTerms(std::string_view raw_query) const {
+    const Query query = ParseQuery(raw_query);
+
+    return {GetSortedTermIds(dictionary_, query.plus_words, max_edit_distance_), GetSortedTermIds(dictionary_, query.minus_words)};
+}
+
+std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchOrdinal(const MatchTerms& terms,
+                                                                                     uint32_t ordinal) const {
+    const DocumentStatus status = static_cast<DocumentStatus>(statuses_[ordinal]);
+    const auto [begin, end] = GetForwardRange(ordinal);
+    const TermId* first = forward_term_ids_.data() + begin;
+    const TermId* last = forward_term_ids_.data() + end;
+
+    bool has_minus_word = false;
+    IntersectGalloping(terms.minus_term_ids.data(), terms.minus_term_ids.data() + terms.minus_term_ids.size(), first, last,
+                       [&has_minus_word](TermId) {
+                           has_minus_word = true;
+                       });
+    if (has_minus_word) {
+        return {std::vector<std::string_view>(), status};
+    }
+
+    std::vector<std::string_view> match_words;
+    IntersectGalloping(terms.plus_term_ids.data(), terms.plus_term_ids.data() + terms.plus_term_ids.size(), first, last,
+                       [this, &match_words](TermId term_id) {
+                           // dictionary keeps the word alive, unlike the query text
+                           match_words.push_back(dictionary_.GetTerm(term_id));
+                       });
+    std::sort(match_words.begin(), match_words.end());
+
+    return {match_words, status};
+}
+
+void SearchServer::GetTermPostings(const std::vector<std::string_view>& words, const CollectionStatistics* statistics,
+                                   std::vector<TermPostings>& term_postings, int max_edit_distance) const {
+    term_postings.clear();
+
+    const auto add_term = [this, statistics, &term_postings](TermId term_id, std::string_view term, int edit_distance) {
+        const double weight = std::pow(FUZZY_TERM_WEIGHT, edit_distance);
+
+        if (statistics == nullptr) {
+            // a term of tombstoned documents only has nothing to score
+            if (GetDocumentFreq(term_id) > 0) {
+                term_postings.push_back({term_id, &postings_[term_id], ComputeWordInverseDocumentFreq(term_id) * weight, edit_distance});
+            }
+            return;
+        }
+
+        const auto document_freq = statistics->document_freqs.find(term);
+        if (document_freq != statistics->document_freqs.end() && document_freq->second > 0) {
+            const double inverse_document_freq = std::log(statistics->document_count * 1.0 / document_freq->second);
+            term_postings.push_back({term_id, &postings_[term_id], inverse_document_freq * weight, edit_distance});
+        }
+    };
+
+    // a pattern or a word with similar terms becomes several terms, and they are unioned by scoring
+    // just like words of the query
+    bool has_expanded_word = false;
+    std::vector<TermId> pattern_term_ids;
+    std::vector<std::pair<TermId, int>> similar_terms;
+
+    for (std::string_view word : words) {
+        if (TermDictionary::IsPattern(word)) {
+            has_expanded_word = true;
+            pattern_term_ids.clear();
+            dictionary_.FindMatching(word, MAX_PATTERN_TERM_COUNT, pattern_term_ids);
+
+            for (const TermId term_id : pattern_term_ids) {
+                add_term(term_id, dictionary_.GetTerm(term_id), 0);
+            }
+            continue;
+        }
+
+        const int edit_distance = GetWordEditDistance(word, max_edit_distance);
+        if (edit_distance > 0) {
+            has_expanded_word = true;
+            FindSimilarTerms(dictionary_, word, edit_distance, similar_terms);
+
+            for (const auto& [term_id, term_edit_distance] : similar_terms) {
+                add_term(term_id, dictionary_.GetTerm(term_id), term_edit_distance);
+            }
+            continue;
+        }
+
+        const TermId term_id = dictionary_.Find(word);
+
+        if (term_id != NO_TERM) {
+            add_term(term_id, word, 0);
+        }
+    }
+
+    // a term may come from several words, the closest of them counts. Terms are ordered by text, not
+    // by id, which only makes their order deterministic: parts of a collection number terms differently
+    if (has_expanded_word) {
+        std::sort(term_postings.begin(), term_postings.end(), [this](const TermPostings& lhs, const TermPostings& rhs) {
+            const std::string_view lhs_term = dictionary_.GetTerm(lhs.term_id);
+            const std::string_view rhs_term = dictionary_.GetTerm(rhs.term_id);
+
+            return lhs_term != rhs_term ? lhs_term < rhs_term : lhs.edit_distance < rhs.edit_distance;
+        });
+        term_postings.erase(std::unique(term_postings.begin(), term_postings.end(),
+                                        [](const TermPostings& lhs, const TermPostings& rhs) {
+                                            return lhs.term_id == rhs.term_id;
+                                        }),
+                            term_postings.end());
+    }
+}
+
+void SearchServer::BuildExclusion(const std::vector<TermPostings>& term_postings, RoaringBitmap& excluded) const {
+    excluded.Clear();
+
+    uint32_t ordinals[PostingList::BLOCK_SIZE];
+    uint32_t term_counts[PostingList::BLOCK_SIZE];
+
+    for (const TermPostings& term : term_postings) {
+        for (size_t block = 0; block < term.postings->GetBlockCount(); ++block) {
+            const size_t block_size = term.postings->DecodeBlock(block, ordinals, term_counts);
+
+            for (size_t i = 0; i < block_size; ++i) {
+                excluded.Add(ordinals[i]);
+            }
+        }
+    }
+}
+
+bool SearchServer::HasAnyTerm(uint32_t ordinal, const std::vector<TermPostings>& term_postings) const {
+    const auto [begin, end] = GetForwardRange(ordinal);
+    const TermId* first = forward_term_ids_.data() + begin;
+    const TermId* last = forward_term_ids_.data() + end;
+
+    return std::any_of(term_postings.begin(), term_postings.end(), [first, last](const TermPostings& term) {
+        return std::binary_search(first, last, term.term_id);
+    });
+}
+
+uint64_t SearchServer::ComputeFingerprint(uint32_t ordinal) const {
+    const auto [begin, end] = GetForwardRange(ordinal);
+
+    // terms are sorted, so equal sets give equal sequences
+    uint64_t fingerprint = end - begin;
+    for (uint64_t i = begin; i < end; ++i) {
+        fingerprint = MixBits(fingerprint ^ forward_term_ids_[i]);
+    }
+
+    return fingerprint;
+}
+
+void SearchServer::ComputeMinHash(uint32_t ordinal, uint64_t* signature) const {
+    const auto [begin, end] = GetForwardRange(ordinal);
+    std::fill(signature, signature + MINHASH_SIZE, UINT64_MAX);
+
+    // the hash functions are h1 + k * h2 of two hashes of the term, which is as good for MinHash
+    // as independent ones and costs two hashes a term
+    for (uint64_t i = begin; i < end; ++i) {
+        const uint64_t first_hash = MixBits(forward_term_ids_[i]);
+        const uint64_t second_hash = MixBits(first_hash) | 1;
+
+        uint64_t hash = first_hash;
+        for (size_t k = 0; k < MINHASH_SIZE; ++k) {
+            signature[k] = std::min(signature[k], hash);
+            hash += second_hash;
+        }
+    }
+}
+
+bool SearchServer::HasSameTerms(uint32_t lhs, uint32_t rhs) const {
+    const auto [lhs_begin, lhs_end] = GetForwardRange(lhs);
+    const auto [rhs_begin, rhs_end] = GetForwardRange(rhs);
+
+    return std::equal(forward_term_ids_.begin() + lhs_begin, forward_term_ids_.begin() + lhs_end,
+                      forward_term_ids_.begin() + rhs_begin, forward_term_ids_.begin() + rhs_end);
+}
+
+double SearchServer::ComputeJaccardSimilarity(uint32_t lhs, uint32_t rhs) const {
+    auto [lhs_begin, lhs_end] = GetForwardRange(lhs);
+    auto [rhs_begin, rhs_end] = GetForwardRange(rhs);
+    const uint64_t size_sum = (lhs_end - lhs_begin) + (rhs_end - rhs_begin);
+    if (size_sum == 0) {
+        return 1.0;
+    }
+
+    uint64_t common_count = 0;
+    while (lhs_begin < lhs_end && rhs_begin < rhs_end) {
+        const TermId lhs_term = forward_term_ids_[lhs_begin];
+        const TermId rhs_term = forward_term_ids_[rhs_begin];
+
+        common_count += lhs_term == rhs_term;
+        lhs_begin += lhs_term <= rhs_term;
+        rhs_begin += rhs_term <= lhs_term;
+    }
+
+    return static_cast<double>(common_count) / (size_sum - common_count);
+}
+
+SearchServer::ExecutionPlan SearchServer::PlanQuery(std::vector<TermPostings>& plus_postings,
+                                                    const std::vector<TermPostings>& minus_postings, size_t worker_count) const {
+    std::sort(plus_postings.begin(), plus_postings.end(), [](const TermPostings& lhs, const TermPostings& rhs) {
+        return lhs.postings->GetSize() < rhs.postings->GetSize();
+    });
+
+    double plus_posting_count = 0.0;
+    for (const TermPostings& term : plus_postings) {
+        plus_posting_count += term.postings->GetSize();
+    }
+    double minus_posting_count = 0.0;
+    for (const TermPostings& term : minus_postings) {
+        minus_posting_count += term.postings->GetSize();
+    }
+    const double candidate_count = std::min(plus_posting_count, static_cast<double>(ordinal_to_id_.size()));
+
+    ExecutionPlan plan;
+    plan.worker_count = worker_count;
+
+    const double term_at_a_time_cost = plus_posting_count + candidate_count * RESULT_DOCUMENT_COST;
+
+    // Once the top is full, terms whose max scores add up to less than the threshold stop giving
+    // candidates. The threshold isn't known before the query is run, the best single term score
+    // is a fair guess at it: frequent terms with low scores are pruned, similar terms are not
+    const auto get_max_score = [](const TermPostings& term) {
+        return term.postings->GetMaxTermFreq() * term.inverse_document_freq;
+    };
+    double threshold = 0.0;
+    for (const TermPostings& term : plus_postings) {
+        threshold = std::max(threshold, get_max_score(term));
+    }
+    double essential_posting_count = 0.0;
+    size_t essential_term_count = 0;
+    for (const TermPostings& term : plus_postings) {
+        double max_score_sum = 0.0;
+        for (const TermPostings& other : plus_postings) {
+            max_score_sum += get_max_score(other) <= get_max_score(term) ? get_max_score(other) : 0.0;
+        }
+
+        if (max_score_sum >= threshold) {
+            essential_posting_count += term.postings->GetSize();
+            ++essential_term_count;
+        }
+    }
+    const double document_at_a_time_cost = essential_posting_count * (1.0 + essential_term_count * CURSOR_COMPARISON_COST);
+    if (worker_count > 1 || term_at_a_time_cost < document_at_a_time_cost) {
+        plan.scoring = ScoringStrategy::TERM_AT_A_TIME;
+        plan.estimated_cost = term_at_a_time_cost;
+    } else {
+        plan.scoring = ScoringStrategy::DOCUMENT_AT_A_TIME;
+        plan.estimated_cost = document_at_a_time_cost;
+    }
+
+    if (minus_postings.empty()) {
+        plan.exclusion = ExclusionStrategy::NONE;
+        return plan;
+    }
+
+    // selective minus words are cheap to collect, broad ones are cheaper to look up for candidates
+    const double bitmap_cost = minus_posting_count * BITMAP_ADDITION_COST + plus_posting_count * BITMAP_TEST_COST;
+    const double lookup_cost = candidate_count * minus_postings.size() * FORWARD_LOOKUP_COST;
+    if (bitmap_cost <= lookup_cost) {
+        plan.exclusion = ExclusionStrategy::BEFORE_SCORING;
+        plan.estimated_cost += bitmap_cost;
+    } else {
+        plan.exclusion = ExclusionStrategy::CANDIDATE_LOOKUP;
+        plan.estimated_cost += lookup_cost;
+    }
+
+    return plan;
+}
+
+QueryPlan SearchServer::MakeQueryPlan(const Query& query, const std::vector<TermPostings>& plus_postings,
+                                      const std::vector<TermPostings>& minus_postings, const ExecutionPlan& plan) const {
+    QueryPlan query_plan;
+    query_plan.scoring = plan.scoring;
+    query_plan.exclusion = plan.exclusion;
+    query_plan.worker_count = plan.worker_count;
+    query_plan.estimated_cost = plan.estimated_cost;
+
+    for (const TermPostings& term : plus_postings) {
+        query_plan.plus_terms.push_back({std::string(dictionary_.GetTerm(term.term_id)), term.postings->GetSize()});
+    }
+    for (const TermPostings& term : minus_postings) {
+        query_plan.minus_terms.push_back({std::string(dictionary_.GetTerm(term.term_id)), term.postings->GetSize()});
+    }
+
+    std::vector<TermId> pattern_term_ids;
+    std::vector<std::pair<TermId, int>> similar_terms;
+    for (const std::vector<std::string_view>* words : {&query.plus_words, &query.minus_words}) {
+        for (std::string_view word : *words) {
+            bool is_found = false;
+            const int edit_distance = words == &query.plus_words ? GetWordEditDistance(word, max_edit_distance_) : 0;
+
+            if (edit_distance > 0) {
+                FindSimilarTerms(dictionary_, word, edit_distance, similar_terms);
+                is_found = !similar_terms.empty();
+            } else if (TermDictionary::IsPattern(word)) {
+                pattern_term_ids.clear();
+                dictionary_.FindMatching(word, 1, pattern_term_ids);
+                is_found = !pattern_term_ids.empty();
+            } else {
+                is_found = dictionary_.Find(word) != NO_TERM;
+            }
+
+            if (!is_found) {
+                query_plan.skipped_words.emplace_back(word);
+            }
+        }
+    }
+
+    return query_plan;
+}
+
+SearchServer::BatchQuery SearchServer::MakeBatchQuery(std::string_view raw_query) const {
+    const Query query = ParseQuery(raw_query);
+    BatchQuery batch_query;
+
+    GetTermPostings(query.plus_words, nullptr, batch_query.plus_postings, max_edit_distance_);
+    GetTermPostings(query.minus_words, nullptr, batch_query.minus_postings);
+
+    return batch_query;
+}
+
+std::vector<std::vector<size_t>> SearchServer::GroupBatchQueries(const std::vector<BatchQuery>& batch_queries,
+                                                                 std::vector<size_t>& repeated_queries) const {
+    // (plus terms, minus terms) tell a query's result, whatever order and stop words it has. A term is
+    // (id, edit distance), since a similar term weighs less than the same term typed
+    std::map<std::pair<std::vector<std::pair<TermId, int>>, std::vector<std::pair<TermId, int>>>, size_t> first_queries;
+    const auto get_term_ids = [](const std::vector<TermPostings>& term_postings) {
+        std::vector<std::pair<TermId, int>> term_ids;
+        term_ids.reserve(term_postings.size());
+        for (const TermPostings& term : term_postings) {
+            term_ids.emplace_back(term.term_id, term.edit_distance);
+        }
+        std::sort(term_ids.begin(), term_ids.end());
+        return term_ids;
+    };
+
+    repeated_queries.resize(batch_queries.size());
+    for (size_t query = 0; query < batch_queries.size(); ++query) {
+        const auto term_ids = std::make_pair(get_term_ids(batch_queries[query].plus_postings),
+                                             get_term_ids(batch_queries[query].minus_postings));
+        repeated_queries[query] = first_queries.emplace(term_ids, query).first->second;
+    }
+
+    std::vector<std::vector<size_t>> groups;
+
+    // (heaviest term, query), queries without plus words found nothing and go nowhere. Scores of a
+    // group are shared by its queries, so a query with similar terms, weighing less, is alone
+    std::vector<std::pair<TermId, size_t>> heaviest_terms;
+    for (size_t query = 0; query < batch_queries.size(); ++query) {
+        const std::vector<TermPostings>& plus_postings = batch_queries[query].plus_postings;
+        const bool has_similar_terms = std::any_of(plus_postings.begin(), plus_postings.end(), [](const TermPostings& term) {
+            return term.edit_distance > 0;
+        });
+
+        if (repeated_queries[query] == query && has_similar_terms) {
+            groups.push_back({query});
+        } else if (repeated_queries[query] == query && !plus_postings.empty()) {
+            const auto heaviest = std::max_element(plus_postings.begin(), plus_postings.end(), [](const TermPostings& lhs, const TermPostings& rhs) {
+                return lhs.postings->GetSize() < rhs.postings->GetSize();
+            });
+            heaviest_terms.emplace_back(heaviest->term_id, query);
+        }
+    }
+    std::sort(heaviest_terms.begin(), heaviest_terms.end());
+
+    for (size_t i = 0; i < heaviest_terms.size(); ++i) {
+        if (i % BATCH_GROUP_SIZE == 0) {
+            groups.emplace_back();
+        }
+        groups.back().push_back(heaviest_terms[i].second);
+    }
+
+    return groups;
+}
+
+void SearchServer::FindTopDocumentsInGroup(const std::vector<std::string>& queries, const std::vector<BatchQuery>& batch_queries,
+                                           const std::vector<size_t>& group, std::vector<std::vector<Document>>& results) const {
+    // (term, query's position in the group)
+    std::vector<std::pair<TermId, size_t>> term_queries;
+    for (size_t position = 0; position < group.size(); ++position) {
+        for (const TermPostings& term : batch_queries[group[position]].plus_postings) {
+            term_queries.emplace_back(term.term_id, position);
+        }
+    }
+    std::sort(term_queries.begin(), term_queries.end());
+
+    // Scoring together saves decoding of shared posting lists, but loses pruning, so a query
+    // is scored with the group only if that's cheaper than its own plan
+    const auto get_run_lengths = [&term_queries]() {
+        std::vector<size_t> run_lengths(term_queries.size());
+        for (size_t run_begin = 0; run_begin < term_queries.size();) {
+            size_t run_end = run_begin;
+            while (run_end < term_queries.size() && term_queries[run_end].first == term_queries[run_begin].first) {
+                ++run_end;
+            }
+            std::fill(run_lengths.begin() + run_begin, run_lengths.begin() + run_end, run_end - run_begin);
+            run_begin = run_end;
+        }
+        return run_lengths;
+    };
+
+    std::vector<double> group_costs(group.size(), 0.0);
+    std::vector<size_t> run_lengths = get_run_lengths();
+    for (size_t i = 0; i < term_queries.size(); ++i) {
+        const double posting_count = postings_[term_queries[i].first].GetSize();
+        group_costs[term_queries[i].second] += posting_count * (1.0 - POSTING_DECODING_COST + POSTING_DECODING_COST / run_lengths[i]);
+    }
+
+    std::vector<bool> is_grouped(group.size(), false);
+    for (size_t position = 0; position < group.size(); ++position) {
+        const BatchQuery& batch_query = batch_queries[group[position]];
+        std::vector<TermPostings> plus_postings = batch_query.plus_postings;
+        const ExecutionPlan plan = PlanQuery(plus_postings, batch_query.minus_postings, 1);
+
+        double posting_count = 0.0;
+        for (const TermPostings& term : plus_postings) {
+            posting_count += term.postings->GetSize();
+        }
+        const double candidate_count = std::min(posting_count, static_cast<double>(ordinal_to_id_.size()));
+        const double group_cost = group_costs[position] + candidate_count * (RESULT_DOCUMENT_COST + group.size() * BATCH_SLOT_COST) +
+                                  candidate_count * batch_query.minus_postings.size() * FORWARD_LOOKUP_COST;
+
+        is_grouped[position] = group_cost < plan.estimated_cost;
+    }
+
+    // a query left without a shared term is on its own too
+    term_queries.erase(std::remove_if(term_queries.begin(), term_queries.end(), [&is_grouped](const std::pair<TermId, size_t>& term_query) {
+                           return !is_grouped[term_query.second];
+                       }),
+                       term_queries.end());
+    run_lengths = get_run_lengths();
+    std::fill(is_grouped.begin(), is_grouped.end(), false);
+    for (size_t i = 0; i < term_queries.size(); ++i) {
+        if (run_lengths[i] > 1) {
+            is_grouped[term_queries[i].second] = true;
+        }
+    }
+    term_queries.erase(std::remove_if(term_queries.begin(), term_queries.end(), [&is_grouped](const std::pair<TermId, size_t>& term_query) {
+                           return !is_grouped[term_query.second];
+                       }),
+                       term_queries.end());
+
+    for (size_t position = 0; position < group.size(); ++position) {
+        if (!is_grouped[position]) {
+            results[group[position]] = FindTopDocuments(std::execution::seq, queries[group[position]]);
+        }
+    }
+    if (term_queries.empty()) {
+        return;
+    }
+
+    QueryScratchLease lease;
+    BatchScoreAccumulator& accumulator = lease.Get().batch_accumulator;
+    accumulator.Reset(ordinal_to_id_.size(), group.size());
+
+    uint32_t ordinals[PostingList::BLOCK_SIZE];
+    uint32_t term_counts[PostingList::BLOCK_SIZE];
+    double scores[PostingList::BLOCK_SIZE];
+    ByStatus is_actual{DocumentStatus::ACTUAL};
+
+    // every posting list is decoded once, and its scores go to all the queries having the term
+    for (size_t run_begin = 0; run_begin < term_queries.size();) {
+        const TermId term_id = term_queries[run_begin].first;
+        size_t run_end = run_begin;
+        while (run_end < term_queries.size() && term_queries[run_end].first == term_id) {
+            ++run_end;
+        }
+        const PostingList& postings = postings_[term_id];
+        const double inverse_document_freq = ComputeWordInverseDocumentFreq(term_id);
+
+        for (size_t block = 0; block < postings.GetBlockCount(); ++block) {
+            const size_t block_size = postings.DecodeBlock(block, ordinals, term_counts);
+
+            size_t actual_count = 0;
+            for (size_t i = 0; i < block_size; ++i) {
+                ordinals[actual_count] = ordinals[i];
+                term_counts[actual_count] = term_counts[i];
+                actual_count += IsAccepted(is_actual, ordinals[i]) ? 1 : 0;
+            }
+
+            ComputeScores(ordinals, term_counts, actual_count, inv_word_counts_.data(), inverse_document_freq, scores);
+            for (size_t i = 0; i < actual_count; ++i) {
+                for (size_t run = run_begin; run < run_end; ++run) {
+                    accumulator.Add(ordinals[i], term_queries[run].second, scores[i]);
+                }
+            }
+        }
+
+        run_begin = run_end;
+    }
+
+    std::vector<TopDocuments> top_documents(group.size(), TopDocuments(MAX_RESULT_DOCUMENT_COUNT));
+    for (const uint32_t ordinal : accumulator.GetTouched()) {
+        for (size_t position = 0; position < group.size(); ++position) {
+            if (!accumulator.IsMatched(ordinal, position)) {
+                continue;
+            }
+
+            // a document less relevant than the worst of a full top can't get there
+            const double score = accumulator.GetScore(ordinal, position);
+            TopDocuments& top = top_documents[position];
+            if (top.IsFull() && score < top.GetWorst().relevance - EPS) {
+                continue;
+            }
+
+            const std::vector<TermPostings>& minus_postings = batch_queries[group[position]].minus_postings;
+            if (!minus_postings.empty() && HasAnyTerm(ordinal, minus_postings)) {
+                continue;
+            }
+
+            top.Push(MakeDocument(ordinal, score));
+        }
+    }
+
+    for (size_t position = 0; position < group.size(); ++position) {
+        if (is_grouped[position]) {
+            results[group[position]] = top_documents[position].Extract();
+        }
+    }
+}
+
+SearchServer::QueryScratchLease::QueryScratchLease() {
+    static thread_local QueryScratch thread_scratch;
+
+    if (thread_scratch.is_used) {
+        own_scratch_ = std::make_unique<QueryScratch>();
+        scratch_ = own_scratch_.get();
+    } else {
+        scratch_ = &thread_scratch;
+    }
+
+    scratch_->is_used = true;
+}
+
+SearchServer::QueryScratchLease::~QueryScratchLease() {
+    scratch_->is_used = false;
+}
+
+SearchServer::QueryScratch& SearchServer::QueryScratchLease::Get() {
+    return *scratch_;
 }
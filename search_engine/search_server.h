@@ -1,25 +1,67 @@
 #pragma once
 #include <algorithm>
+#include <array>
 #include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <exception>
 #include <execution>
 #include <functional>
+#include <future>
+#include <limits>
 #include <map>
-#include <mutex>
+#include <memory>
+#include <numeric>
 #include <set>
+#include <stdexcept>
 #include <string>
 #include <string_view>
+#include <thread>
 #include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
 #include <vector>
 
-#include "../helpers/concurrent_map/concurrent_map.h"
 #include "../helpers/log_duration.h"
+#include "../helpers/roaring_bitmap/roaring_bitmap.h"
+#include "async_query.h"
+#include "deletion_set.h"
 #include "document.h"
+#include "index_file.h"
+#include "mappable_vector.h"
+#include "ordinal_bitmap.h"
+#include "posting_list.h"
+#include "query_cache.h"
+#include "query_plan.h"
+#include "score_accumulator.h"
+#include "score_kernel.h"
+#include "search_cursor.h"
 #include "string_processing.h"
+#include "term_dictionary.h"
+#include "tokenizer.h"
+#include "top_documents.h"
 
 const int MAX_RESULT_DOCUMENT_COUNT = 5;
-const double EPS = 1e-6;
+// a query word with '*' or '?' (like "cat*") stands for at most this many terms of the index, the
+// lexicographically first ones. Shards and segments are indexes of their own, each bounded separately
+const size_t MAX_PATTERN_TERM_COUNT = 256;
+// with fuzzy matching, a plus word also stands for at most this many closest terms, and every edit
+// away from the word multiplies a term's relevance by FUZZY_TERM_WEIGHT
+const int MAX_FUZZY_EDIT_DISTANCE = 2;
+const size_t MAX_FUZZY_TERM_COUNT = 16;
+const double FUZZY_TERM_WEIGHT = 0.5;
+const size_t DOCUMENT_STATUS_COUNT = static_cast<size_t>(DocumentStatus::REMOVED) + 1;
 const std::string OPERATION_TIME_STRING = "Operation time";
 
+// Numbers the relevance depends on. Parts of a bigger collection (like segments) are scored with
+// statistics of the whole collection, so they give the same relevance as a single index would
+struct CollectionStatistics {
+    int document_count = 0;
+    std::map<std::string, int, std::less<>> document_freqs;  // of query words
+};
+
 class SearchServer {
    public:
     template <typename Container>
@@ -29,10 +71,38 @@ class SearchServer {
     SearchServer(std::string_view text);
 
     void AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings);
+    // Adds a range of (id, text, status, ratings) records. Texts are split and counted by workers into
+    // partial indexes, which are merged into the index in one pass. All the records are checked before
+    // anything is added, so an invalid record leaves the index as it was
+    template <typename ExecutionPolicy, typename DocumentRange>
+    void AddDocuments(ExecutionPolicy&& policy, const DocumentRange& documents);
+    template <typename DocumentRange>
+    void AddDocuments(const DocumentRange& documents);
+    // copies documents of an index with the same stop words without splitting their texts again
+    template <typename DocumentPredicate>
+    void CopyDocuments(const SearchServer& other, DocumentPredicate predicate);
+    // copies the documents which aren't deleted
+    void CopyDocuments(const SearchServer& other, const DeletionSet& deletions);
 
     template <typename ExecutionPolicy>
     void RemoveDocument(ExecutionPolicy&& policy, int document_id);
     void RemoveDocument(int document_id);
+    // Removes documents without touching their postings: their ordinals get tombstones, which queries
+    // honor at once, and document frequencies stay exact. The postings are dropped by Compact, so mass
+    // removal costs a few lookups per document instead of rewriting a block of every term. Absent ids are skipped
+    template <typename DocumentIdRange>
+    void RemoveDocuments(const DocumentIdRange& document_ids);
+    // Rewrites the posting lists which have postings of tombstoned documents, the lists are rewritten in
+    // parallel with a parallel policy. Results of queries stay the same
+    template <typename ExecutionPolicy>
+    void Compact(ExecutionPolicy&& policy);
+    void Compact();
+    // documents removed by RemoveDocuments since the last Compact
+    size_t GetTombstoneCount() const;
+    // Deletion from an index which mustn't change, like one being queried: the index stays as it is, and
+    // queries and statistics given the result skip the documents. Absent and deleted ids are skipped
+    template <typename DocumentIdRange>
+    DeletionSet DeleteDocuments(const DeletionSet& deletions, const DocumentIdRange& document_ids) const;
 
     template <typename ExecutionPolicy, typename Comparator>
     std::vector<Document> FindTopDocuments(ExecutionPolicy&& policy, std::string_view raw_query, Comparator comparator) const;
@@ -44,31 +114,175 @@ class SearchServer {
     std::vector<Document> FindTopDocuments(std::string_view raw_query, Comparator comparator) const;
     std::vector<Document> FindTopDocuments(std::string_view raw_query) const;
     std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentStatus status) const;
+    template <typename ExecutionPolicy, typename Comparator>
+    std::vector<Document> FindTopDocuments(ExecutionPolicy&& policy, std::string_view raw_query, Comparator comparator,
+                                           const CollectionStatistics& statistics) const;
+    template <typename ExecutionPolicy, typename Comparator>
+    std::vector<Document> FindTopDocuments(ExecutionPolicy&& policy, std::string_view raw_query, Comparator comparator,
+                                           const CollectionStatistics& statistics, const DeletionSet& deletions) const;
+
+    // Page of the whole ranking of the query: page_size documents ranked after the cursor. Only the
+    // page is kept while scoring, and the cursor's document bounds it, so a deep page costs about as
+    // much as the first one
+    template <typename Comparator>
+    SearchPage FindTopDocuments(std::string_view raw_query, size_t page_size, const SearchCursor& cursor,
+                                Comparator comparator) const;
+    SearchPage FindTopDocuments(std::string_view raw_query, size_t page_size, const SearchCursor& cursor) const;
+
+    // Tops of ACTUAL documents for every query, the same as FindTopDocuments gives. Repeated queries are
+    // evaluated once, the others are grouped by the terms they share, and a group reads every posting
+    // list once for all its queries
+    template <typename ExecutionPolicy>
+    std::vector<std::vector<Document>> FindTopDocumentsInBatch(ExecutionPolicy&& policy, const std::vector<std::string>& queries) const;
+
+    // Runs the query on a thread of the executor, the shared one if none is given. Scoring stops at the
+    // deadline or on cancellation, and the result is the top of the documents scored by then. The index
+    // mustn't change or go away until the result is ready
+    template <typename Comparator>
+    QueryHandle FindTopDocumentsAsync(QueryExecutor& executor, std::string_view raw_query, Comparator comparator,
+                                      std::chrono::steady_clock::time_point deadline) const;
+    QueryHandle FindTopDocumentsAsync(QueryExecutor& executor, std::string_view raw_query,
+                                      std::chrono::steady_clock::time_point deadline) const;
+    QueryHandle FindTopDocumentsAsync(std::string_view raw_query, std::chrono::steady_clock::time_point deadline) const;
+
+    // own statistics of the query's plus words, words absent from the index have zero frequency.
+    // A pattern is replaced by the terms it matches
+    CollectionStatistics GetStatistics(std::string_view raw_query) const;
+    CollectionStatistics GetStatistics(std::string_view raw_query, const DeletionSet& deletions) const;
+
+    // Keeps tops of recent queries in about max_byte_count bytes, a cache enabled again starts empty,
+    // and so does the cache of a copied server.
+    // Only queries filtered by status or by min rating are cached: other comparators can't be told apart
+    void EnableQueryCache(size_t max_byte_count);
+    // all zeros without the cache
+    QueryCacheStatistics GetQueryCacheStatistics() const;
+
+    // Plus words match terms up to max_edit_distance typos away too, 0 turns it off. Short words get
+    // fewer edits: one for 3 to 5 characters, none for shorter ones, which would match anything
+    void SetFuzzyMatching(int max_edit_distance);
+
+    // how FindTopDocuments with the same policy evaluates the query, the query isn't run
+    template <typename ExecutionPolicy>
+    QueryPlan ExplainQuery(ExecutionPolicy&& policy, std::string_view raw_query) const;
+    QueryPlan ExplainQuery(std::string_view raw_query) const;
 
     template <typename ExecutionPolicy>
     std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(ExecutionPolicy&& policy,
                                                                             std::string_view raw_query, int document_id) const;
     std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(std::string_view raw_query, int document_id) const;
+    // the query is parsed once for all the documents, results go in the order of document_ids
+    template <typename ExecutionPolicy>
+    std::vector<std::tuple<std::vector<std::string_view>, DocumentStatus>> MatchDocuments(
+        ExecutionPolicy&& policy, std::string_view raw_query, const std::vector<int>& document_ids) const;
+    std::vector<std::tuple<std::vector<std::string_view>, DocumentStatus>> MatchDocuments(
+        std::string_view raw_query, const std::vector<int>& document_ids) const;
+
+    // Ids of documents with the same words as a document with a smaller id, in ascending order. With
+    // min_similarity below 1, documents whose word sets have at least that Jaccard similarity are
+    // duplicates too: candidates come from MinHash signatures, and their similarity is checked exactly.
+    // Duplicates of duplicates are duplicates, so only the smallest id of such a chain is kept
+    template <typename ExecutionPolicy>
+    std::vector<int> FindDuplicates(ExecutionPolicy&& policy, double min_similarity = 1.0) const;
 
     int GetDocumentCount() const;
 
-    const std::map<std::string, double>& GetWordFrequencies(int document_id) const;
+    std::map<std::string_view, double> GetWordFrequencies(int document_id) const;
+
+    // Binary snapshot of the whole index. An opened index is used right from the mapped file: nothing is
+    // parsed or copied except the id lookup tables. Adding or removing documents afterwards copies
+    // only the touched parts into memory
+    void SaveIndex(const std::string& path) const;
+    static SearchServer OpenIndex(const std::string& path);
 
     std::set<int>::const_iterator begin() const;
     std::set<int>::const_iterator end() const;
 
    private:
-    std::set<std::string> stop_words_;
-    std::map<std::string, std::map<int, double>> word_to_document_freqs_;
-    std::map<int, std::map<std::string, double>> document_to_word_freqs_;
-    std::map<int, Document> document_ratings_status_;
+    Tokenizer tokenizer_;
+    std::vector<std::string_view> words_buffer_;  // AddDocument splits texts into it
+    TermDictionary dictionary_;
+    std::vector<PostingList> postings_;  // by TermId
     std::set<int> document_ids_;
+    std::unordered_map<int, uint32_t> id_to_ordinal_;
+    // by ordinal, removed documents keep their ordinals
+    MappableVector<int> ordinal_to_id_;
+    MappableVector<double> inv_word_counts_;  // term frequency is a term count multiplied by it
+    MappableVector<int> ratings_;
+    MappableVector<int8_t> statuses_;  // REMOVED_ORDINAL_STATUS for removed documents
+    // ordinals of the present documents by status
+    std::array<OrdinalBitmap, DOCUMENT_STATUS_COUNT> status_bitmaps_;
+    // removed documents whose postings are still in the lists, queries skip them
+    OrdinalBitmap tombstones_;
+    std::vector<uint32_t> tombstone_ordinals_;
+    // by TermId, postings of tombstoned documents; a term's document frequency is its list size without them
+    std::vector<uint32_t> tombstone_posting_counts_;
+    // forward index: terms of a document sorted by id start at forward_offsets_[ordinal]
+    MappableVector<uint64_t> forward_offsets_;
+    MappableVector<TermId> forward_term_ids_;
+    MappableVector<uint32_t> forward_term_counts_;
+    // keeps data of an opened index alive
+    std::shared_ptr<const MappedFile> index_file_;
+    // changes whenever a document is added or removed, so cached results of other epochs are stale
+    uint64_t epoch_ = 0;
+    int max_edit_distance_ = 0;
+    QueryCachePtr query_cache_;
+
+    static constexpr size_t QUERY_CACHE_SHARD_COUNT = 16;
+
+    static constexpr int8_t REMOVED_ORDINAL_STATUS = -1;
+
+    // comparators evaluated by the index itself: cheaper than remembering their results
+    template <typename Comparator>
+    static constexpr bool IS_INDEXED_COMPARATOR = std::is_same_v<Comparator, ByStatus> || std::is_same_v<Comparator, ByMinRating>;
+
+    template <typename Comparator>
+    bool IsAccepted(Comparator& comparator, uint32_t ordinal) const;
+
+    // deleted documents are skipped before the comparator is asked, so a status filter keeps its bitmap
+    template <typename Comparator>
+    struct DeletionFilter {
+        Comparator comparator;
+        const DeletionSet* deletions;
+    };
+
+    template <typename Comparator>
+    bool IsAccepted(DeletionFilter<Comparator>& filter, uint32_t ordinal) const;
+
+    Document MakeDocument(uint32_t ordinal, double relevance) const;
 
     static bool HasSpecialCharacters(std::string_view word);
 
-    bool IsStopWord(std::string_view word) const;
+    // throws if the text has special characters
+    void SplitIntoWordsNoStopAndValid(std::string_view text, std::vector<std::string_view>& words) const;
+
+    // term_counts are sorted by term and don't repeat
+    void AddDocumentTerms(int document_id, const std::vector<std::pair<std::string_view, uint32_t>>& term_counts,
+                          double inv_word_count, const Document& document_data);
+    // everything but postings; the document's terms are already in the forward index
+    void AddDocumentData(int document_id, double inv_word_count, const Document& document_data);
+    static bool IsValidStatus(int8_t status);
+    // status is REMOVED_ORDINAL_STATUS or a valid one
+    void SetStatus(uint32_t ordinal, int8_t status);
+    // counts the postings of the document by its terms in the forward index
+    void AddTombstone(uint32_t ordinal);
+    // the list without postings of tombstoned documents
+    PostingList CompactPostings(const PostingList& postings) const;
+
+    // a batch is split between workers only if each of them gets at least this much documents
+    static const size_t MIN_DOCUMENTS_PER_WORKER = 1 << 8;
 
-    std::vector<std::string_view> SplitIntoWordsNoStopAndValid(std::string_view text) const;
+    // index of a part of a batch with own term ids, which become dictionary ones on merging
+    struct PartialIndex {
+        size_t first_document = 0;  // in the batch
+        std::vector<std::string_view> terms;
+        std::vector<std::vector<std::pair<uint32_t, uint32_t>>> postings;  // by term: document in the part and term count
+        std::vector<uint64_t> document_offsets;  // the part's documents' terms start at them in document_terms
+        std::vector<std::pair<uint32_t, uint32_t>> document_terms;  // term and term count
+        std::vector<double> inv_word_counts;
+    };
+
+    // splits texts [begin, end) of a batch, throws like AddDocument does
+    PartialIndex BuildPartialIndex(const std::vector<std::string_view>& texts, size_t begin, size_t end) const;
 
     static int ComputeAverageRating(const std::vector<int>& ratings);
 
@@ -81,17 +295,173 @@ class SearchServer {
     QueryWord ParseQueryWord(std::string_view text) const;
 
     struct Query {
-        std::set<std::string_view> plus_words;
-        std::set<std::string_view> minus_words;
+        // sorted and without repeats
+        std::vector<std::string_view> plus_words;
+        std::vector<std::string_view> minus_words;
     };
 
+    // words is a buffer for the text's words; vectors of the query keep their memory when it's reused
+    void ParseQuery(std::string_view text, std::vector<std::string_view>& words, Query& query) const;
     Query ParseQuery(std::string_view text) const;
 
-    // Existence required
-    double ComputeWordInverseDocumentFreq(const std::string& word) const;
+    // [begin, end) of the document's terms in the forward index
+    std::pair<uint64_t, uint64_t> GetForwardRange(uint32_t ordinal) const;
+
+    // query words present in the index, sorted by id like the terms of the forward index
+    struct MatchTerms {
+        std::vector<TermId> plus_term_ids;
+        std::vector<TermId> minus_term_ids;
+    };
+
+    MatchTerms GetMatchTerms(std::string_view raw_query) const;
+    // plus words of the document in lexicographical order, none if it has a minus word
+    std::tuple<std::vector<std::string_view>, DocumentStatus> MatchOrdinal(const MatchTerms& terms, uint32_t ordinal) const;
+
+    int GetDocumentFreq(TermId term_id) const;
+    double ComputeWordInverseDocumentFreq(TermId term_id) const;
+
+    struct TermPostings {
+        TermId term_id;
+        const PostingList* postings;
+        double inverse_document_freq;  // lowered by the edit distance
+        int edit_distance = 0;  // from the query word of a similar term
+    };
+
+    // Words absent from the index are skipped, as well as words the statistics have no documents for.
+    // With max_edit_distance, similar terms are added too
+    void GetTermPostings(const std::vector<std::string_view>& words, const CollectionStatistics* statistics,
+                         std::vector<TermPostings>& term_postings, int max_edit_distance = 0) const;
+    // documents of any of the terms
+    void BuildExclusion(const std::vector<TermPostings>& term_postings, RoaringBitmap& excluded) const;
+    // whether the document has any of the terms, they are looked up in its forward index
+    bool HasAnyTerm(uint32_t ordinal, const std::vector<TermPostings>& term_postings) const;
 
+    // QueryPlan without words, so planning a query allocates nothing
+    struct ExecutionPlan {
+        ScoringStrategy scoring;
+        ExclusionStrategy exclusion;
+        size_t worker_count;
+        double estimated_cost;
+    };
+
+    // Picks the cheapest way to evaluate a query by the posting counts of its terms, sorts plus terms
+    // by posting count. Work split between several workers is term-at-a-time only
+    ExecutionPlan PlanQuery(std::vector<TermPostings>& plus_postings, const std::vector<TermPostings>& minus_postings,
+                            size_t worker_count) const;
+    QueryPlan MakeQueryPlan(const Query& query, const std::vector<TermPostings>& plus_postings,
+                            const std::vector<TermPostings>& minus_postings, const ExecutionPlan& plan) const;
+
+    struct TermCursor {
+        PostingList::Cursor cursor;
+        double inverse_document_freq;
+        double max_score;
+    };
+
+    // Buffers of the query path. Every thread keeps its scratch between queries, so once the buffers
+    // have grown, a sequential query allocates only for its result
+    struct QueryScratch {
+        bool is_used = false;
+        QueryControl* control = nullptr;  // of an asynchronous query
+        // the query gives top_count documents ranked after this one, if it's set
+        const Document* after = nullptr;
+        size_t top_count = MAX_RESULT_DOCUMENT_COUNT;
+        std::vector<std::string_view> words;
+        Query query;
+        std::vector<TermPostings> plus_postings;
+        std::vector<TermPostings> minus_postings;
+        RoaringBitmap excluded;
+        std::vector<TermCursor> terms;
+        std::vector<double> max_score_prefix;
+        ScoreAccumulator accumulator;
+        std::vector<Document> documents;
+        BatchScoreAccumulator batch_accumulator;
+        QueryCacheKey cache_key;
+    };
+
+    // The thread's scratch for the time of a query. A query run from a comparator of another query
+    // on the same thread gets a scratch of its own
+    class QueryScratchLease {
+       public:
+        QueryScratchLease();
+        QueryScratchLease(const QueryScratchLease&) = delete;
+        QueryScratchLease& operator=(const QueryScratchLease&) = delete;
+        ~QueryScratchLease();
+
+        QueryScratch& Get();
+
+       private:
+        std::unique_ptr<QueryScratch> own_scratch_;
+        QueryScratch* scratch_;
+    };
+
+    // a parallel query is split between workers only if each of them gets at least this much postings
+    static const size_t MIN_POSTINGS_PER_WORKER = 1 << 14;
+    // ordinals are reduced from the workers' accumulators by chunks of this size
+    static const size_t REDUCE_CHUNK_SIZE = 1 << 12;
+    // document-at-a-time scoring asks whether to stop once per this many candidates
+    static const size_t STOP_CHECK_INTERVAL = 1 << 8;
+
+    template <typename ExecutionPolicy>
+    static size_t ComputeWorkerCount(const std::vector<TermPostings>& term_postings);
+
+    // stops at a posting block if the control says so
+    template <typename Comparator>
+    void AccumulateScores(const std::vector<TermPostings>& term_postings, size_t begin, size_t end,
+                          const RoaringBitmap& excluded, Comparator comparator, QueryControl* control,
+                          ScoreAccumulator& accumulator) const;
+
+    // for indexed comparators only
+    template <typename Comparator>
+    static void MakeQueryCacheKey(const std::vector<TermPostings>& plus_postings, const std::vector<TermPostings>& minus_postings,
+                                  Comparator comparator, QueryCacheKey& key);
+
+    // statistics, control and the document to rank after are optional, the index's own statistics are used
+    // without them
     template <typename ExecutionPolicy, typename Comparator>
-    std::vector<Document> FindAllDocuments(ExecutionPolicy&& policy, const Query& query, Comparator comparator) const;
+    std::vector<Document> FindTopDocumentsWithStatistics(ExecutionPolicy&& policy, std::string_view raw_query,
+                                                         Comparator comparator, const CollectionStatistics* statistics,
+                                                         QueryControl* control = nullptr, const Document* after = nullptr,
+                                                         size_t top_count = MAX_RESULT_DOCUMENT_COUNT) const;
+
+    // into scratch.documents
+    template <typename ExecutionPolicy, typename Comparator>
+    void FindAllDocuments(ExecutionPolicy&& policy, QueryScratch& scratch, const ExecutionPlan& plan, Comparator comparator) const;
+
+    // MaxScore with block-max bounds: documents which can't get into the top are skipped without
+    // reading all their postings. Gives the same result as sorting all the found documents
+    template <typename Comparator>
+    std::vector<Document> FindTopDocumentsDocumentAtATime(QueryScratch& scratch, const ExecutionPlan& plan,
+                                                          Comparator comparator) const;
+
+    // a signature of MINHASH_BAND_COUNT bands, documents with an equal band are compared
+    static const size_t MINHASH_BAND_COUNT = 16;
+    static const size_t MINHASH_BAND_SIZE = 4;
+    static const size_t MINHASH_SIZE = MINHASH_BAND_COUNT * MINHASH_BAND_SIZE;
+    // a document is compared with at most this many previous documents of a bucket
+    static const size_t MAX_BUCKET_COMPARISONS = 32;
+
+    // of the document's set of terms
+    uint64_t ComputeFingerprint(uint32_t ordinal) const;
+    void ComputeMinHash(uint32_t ordinal, uint64_t* signature) const;
+    bool HasSameTerms(uint32_t lhs, uint32_t rhs) const;
+    double ComputeJaccardSimilarity(uint32_t lhs, uint32_t rhs) const;
+
+    struct BatchQuery {
+        std::vector<TermPostings> plus_postings;
+        std::vector<TermPostings> minus_postings;
+    };
+
+    // scores of an ordinal for all the queries of a group take a cache line
+    static const size_t BATCH_GROUP_SIZE = 8;
+    static_assert(BATCH_GROUP_SIZE <= BatchScoreAccumulator::MAX_QUERY_COUNT);
+
+    BatchQuery MakeBatchQuery(std::string_view raw_query) const;
+    // Queries with the same heaviest term go to the same group, as that term costs them the most.
+    // Of the queries with the same terms only the first one is grouped, the others are its repeats
+    std::vector<std::vector<size_t>> GroupBatchQueries(const std::vector<BatchQuery>& batch_queries,
+                                                       std::vector<size_t>& repeated_queries) const;
+    void FindTopDocumentsInGroup(const std::vector<std::string>& queries, const std::vector<BatchQuery>& batch_queries,
+                                 const std::vector<size_t>& group, std::vector<std::vector<Document>>& results) const;
 };
 
 template <typename Container>
@@ -107,51 +477,468 @@ SearchServer::SearchServer(const Container& stop_words) {
             throw std::invalid_argument("Step words mustn't include special characters"s);
         }
 
-        stop_words_.insert(std::string(word));
+        tokenizer_.AddStopWord(word);
+    }
+}
+
+template <typename ExecutionPolicy, typename DocumentRange>
+void SearchServer::AddDocuments(ExecutionPolicy&& policy, const DocumentRange& documents) {
+    using namespace std::string_literals;
+
+    std::vector<int> document_ids;
+    std::vector<std::string_view> texts;
+    std::vector<Document> documents_data;
+    std::unordered_set<int> batch_ids;
+
+    for (const auto& [document_id, text, status, ratings] : documents) {
+        if (document_id < 0) {
+            throw std::invalid_argument("Document id mustn't be negative"s);
+        } else if (id_to_ordinal_.count(document_id) || !batch_ids.insert(document_id).second) {
+            throw std::invalid_argument("Document with such id has already added"s);
+        } else if (!IsValidStatus(static_cast<int8_t>(status))) {
+            throw std::invalid_argument("Invalid document status"s);
+        }
+
+        document_ids.push_back(document_id);
+        texts.emplace_back(text);
+        documents_data.emplace_back(ComputeAverageRating(ratings), status);
+    }
+
+    size_t part_count = 1;
+    if constexpr (!std::is_same_v<std::decay_t<ExecutionPolicy>, std::execution::sequenced_policy>) {
+        const size_t thread_count = std::max(std::thread::hardware_concurrency(), 1u);
+
+        part_count = std::clamp(texts.size() / MIN_DOCUMENTS_PER_WORKER, static_cast<size_t>(1), thread_count);
+    }
+
+    std::vector<size_t> parts(part_count);
+    std::iota(parts.begin(), parts.end(), 0);
+    std::vector<PartialIndex> partial_indexes(part_count);
+    // an exception can't leave a parallel algorithm, so it's kept to be thrown afterwards
+    std::vector<std::exception_ptr> errors(part_count);
+
+    std::for_each(
+        policy,
+        parts.begin(), parts.end(),
+        [&](size_t part) {
+            try {
+                partial_indexes[part] = BuildPartialIndex(texts, texts.size() * part / part_count,
+                                                          texts.size() * (part + 1) / part_count);
+            } catch (...) {
+                errors[part] = std::current_exception();
+            }
+        });
+
+    for (const std::exception_ptr& error : errors) {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+
+    // the dictionary is the only part merged by one thread, and it gets every term of a part once
+    std::vector<std::vector<TermId>> term_ids(part_count);
+    for (size_t part = 0; part < part_count; ++part) {
+        for (std::string_view term : partial_indexes[part].terms) {
+            const TermId term_id = dictionary_.Insert(term);
+            if (term_id == postings_.size()) {
+                postings_.emplace_back();
+            }
+
+            term_ids[part].push_back(term_id);
+        }
+    }
+
+    const uint32_t first_ordinal = static_cast<uint32_t>(ordinal_to_id_.size());
+
+    // every worker appends to its own share of the lists, taking the parts in order of ordinals
+    std::for_each(
+        policy,
+        parts.begin(), parts.end(),
+        [&](size_t worker) {
+            for (size_t part = 0; part < part_count; ++part) {
+                const PartialIndex& partial_index = partial_indexes[part];
+
+                for (size_t term = 0; term < partial_index.terms.size(); ++term) {
+                    const TermId term_id = term_ids[part][term];
+                    if (term_id % part_count != worker) {
+                        continue;
+                    }
+
+                    for (const auto& [document, term_count] : partial_index.postings[term]) {
+                        const uint32_t ordinal = first_ordinal + static_cast<uint32_t>(partial_index.first_document + document);
+
+                        postings_[term_id].Append(ordinal, term_count, term_count * partial_index.inv_word_counts[document]);
+                    }
+                }
+            }
+        });
+
+    // forward index of every part goes to its own place of the arrays
+    std::vector<uint64_t> forward_begins(part_count + 1, forward_term_ids_.size());
+    for (size_t part = 0; part < part_count; ++part) {
+        forward_begins[part + 1] = forward_begins[part] + partial_indexes[part].document_terms.size();
+    }
+
+    std::vector<uint64_t>& forward_offsets = forward_offsets_.Edit();
+    std::vector<TermId>& forward_term_ids = forward_term_ids_.Edit();
+    std::vector<uint32_t>& forward_term_counts = forward_term_counts_.Edit();
+    forward_offsets.resize(first_ordinal + texts.size());
+    forward_term_ids.resize(forward_begins.back());
+    forward_term_counts.resize(forward_begins.back());
+
+    std::for_each(
+        policy,
+        parts.begin(), parts.end(),
+        [&](size_t part) {
+            const PartialIndex& partial_index = partial_indexes[part];
+            std::vector<std::pair<TermId, uint32_t>> forward_terms;
+
+            for (size_t document = 0; document + 1 < partial_index.document_offsets.size(); ++document) {
+                const uint64_t begin = partial_index.document_offsets[document];
+                const uint64_t end = partial_index.document_offsets[document + 1];
+                const uint64_t forward_begin = forward_begins[part] + begin;
+
+                forward_terms.clear();
+                for (uint64_t i = begin; i < end; ++i) {
+                    const auto& [term, term_count] = partial_index.document_terms[i];
+                    forward_terms.emplace_back(term_ids[part][term], term_count);
+                }
+                std::sort(forward_terms.begin(), forward_terms.end());
+
+                forward_offsets[first_ordinal + partial_index.first_document + document] = forward_begin;
+                for (size_t i = 0; i < forward_terms.size(); ++i) {
+                    forward_term_ids[forward_begin + i] = forward_terms[i].first;
+                    forward_term_counts[forward_begin + i] = forward_terms[i].second;
+                }
+            }
+        });
+
+    for (size_t part = 0; part < part_count; ++part) {
+        const PartialIndex& partial_index = partial_indexes[part];
+
+        for (size_t document = 0; document < partial_index.inv_word_counts.size(); ++document) {
+            const size_t batch_document = partial_index.first_document + document;
+
+            AddDocumentData(document_ids[batch_document], partial_index.inv_word_counts[document], documents_data[batch_document]);
+        }
+    }
+}
+
+template <typename DocumentRange>
+void SearchServer::AddDocuments(const DocumentRange& documents) {
+    AddDocuments(std::execution::seq, documents);
+}
+
+template <typename DocumentPredicate>
+void SearchServer::CopyDocuments(const SearchServer& other, DocumentPredicate predicate) {
+    using namespace std::string_literals;
+
+    std::vector<std::pair<std::string_view, uint32_t>> term_counts;
+
+    for (const int document_id : other.document_ids_) {
+        if (!predicate(document_id)) {
+            continue;
+        }
+
+        if (id_to_ordinal_.count(document_id)) {
+            throw std::invalid_argument("Document with such id has already added"s);
+        }
+
+        const uint32_t ordinal = other.id_to_ordinal_.at(document_id);
+        const auto [begin, end] = other.GetForwardRange(ordinal);
+
+        term_counts.clear();
+        for (uint64_t i = begin; i < end; ++i) {
+            term_counts.emplace_back(other.dictionary_.GetTerm(other.forward_term_ids_[i]), other.forward_term_counts_[i]);
+        }
+        std::sort(term_counts.begin(), term_counts.end());
+
+        const Document document_data(other.ratings_[ordinal], static_cast<DocumentStatus>(other.statuses_[ordinal]));
+        AddDocumentTerms(document_id, term_counts, other.inv_word_counts_[ordinal], document_data);
     }
 }
 
 template <typename ExecutionPolicy>
 void SearchServer::RemoveDocument(ExecutionPolicy&& policy, int document_id) {
-    if (document_to_word_freqs_.count(document_id) == 0) {
+    if (id_to_ordinal_.count(document_id) == 0) {
         return;
     }
 
-    const std::map<std::string, double>& word_freqs = document_to_word_freqs_.at(document_id);
+    const uint32_t ordinal = id_to_ordinal_.at(document_id);
+    const auto [begin, end] = GetForwardRange(ordinal);
     std::for_each(
         policy,
-        word_freqs.begin(), word_freqs.end(),
-        [&](const auto& kv) {
-            word_to_document_freqs_.at(kv.first).erase(document_id);
+        forward_term_ids_.begin() + begin, forward_term_ids_.begin() + end,
+        [&](TermId term_id) {
+            postings_[term_id].Erase(ordinal);
         });
 
-    document_to_word_freqs_.erase(document_id);
-    document_ratings_status_.erase(document_id);
+    SetStatus(ordinal, REMOVED_ORDINAL_STATUS);
     document_ids_.erase(document_id);
+    id_to_ordinal_.erase(document_id);
+}
+
+template <typename DocumentIdRange>
+void SearchServer::RemoveDocuments(const DocumentIdRange& document_ids) {
+    for (const int document_id : document_ids) {
+        const auto ordinal = id_to_ordinal_.find(document_id);
+        if (ordinal == id_to_ordinal_.end()) {
+            continue;
+        }
+
+        AddTombstone(ordinal->second);
+        SetStatus(ordinal->second, REMOVED_ORDINAL_STATUS);
+        document_ids_.erase(document_id);
+        id_to_ordinal_.erase(ordinal);
+    }
+}
+
+template <typename DocumentIdRange>
+DeletionSet SearchServer::DeleteDocuments(const DeletionSet& deletions, const DocumentIdRange& document_ids) const {
+    DeletionSet::Builder builder(deletions);
+
+    for (const int document_id : document_ids) {
+        const auto ordinal = id_to_ordinal_.find(document_id);
+        if (ordinal == id_to_ordinal_.end()) {
+            continue;
+        }
+
+        const auto [begin, end] = GetForwardRange(ordinal->second);
+        builder.Add(ordinal->second, forward_term_ids_.data() + begin, forward_term_ids_.data() + end);
+    }
+
+    return builder.Build();
+}
+
+template <typename ExecutionPolicy>
+void SearchServer::Compact(ExecutionPolicy&& policy) {
+    if (tombstone_ordinals_.empty()) {
+        return;
+    }
+
+    std::vector<TermId> term_ids;
+    for (TermId term_id = 0; term_id < tombstone_posting_counts_.size(); ++term_id) {
+        if (tombstone_posting_counts_[term_id] > 0u) {
+            term_ids.push_back(term_id);
+        }
+    }
+
+    // every list is rewritten by one worker
+    std::for_each(
+        policy,
+        term_ids.begin(), term_ids.end(),
+        [this](TermId term_id) {
+            postings_[term_id] = CompactPostings(postings_[term_id]);
+        });
+
+    tombstones_ = OrdinalBitmap();
+    tombstone_ordinals_.clear();
+    tombstone_posting_counts_.clear();
 }
 
 template <typename ExecutionPolicy, typename Comparator>
 std::vector<Document> SearchServer::FindTopDocuments(ExecutionPolicy&& policy,
                                                      std::string_view raw_query, Comparator comparator) const {
-    const Query query = ParseQuery(raw_query);
-    auto matched_documents = FindAllDocuments(policy, query, comparator);
+    return FindTopDocumentsWithStatistics(policy, raw_query, comparator, nullptr);
+}
+
+template <typename ExecutionPolicy, typename Comparator>
+std::vector<Document> SearchServer::FindTopDocuments(ExecutionPolicy&& policy, std::string_view raw_query, Comparator comparator,
+                                                     const CollectionStatistics& statistics) const {
+    return FindTopDocumentsWithStatistics(policy, raw_query, comparator, &statistics);
+}
+
+template <typename ExecutionPolicy, typename Comparator>
+std::vector<Document> SearchServer::FindTopDocuments(ExecutionPolicy&& policy, std::string_view raw_query, Comparator comparator,
+                                                     const CollectionStatistics& statistics, const DeletionSet& deletions) const {
+    return FindTopDocumentsWithStatistics(policy, raw_query, DeletionFilter<Comparator>{comparator, &deletions}, &statistics);
+}
+
+template <typename ExecutionPolicy, typename Comparator>
+std::vector<Document> SearchServer::FindTopDocumentsWithStatistics(ExecutionPolicy&& policy, std::string_view raw_query,
+                                                                   Comparator comparator, const CollectionStatistics* statistics,
+                                                                   QueryControl* control, const Document* after, size_t top_count) const {
+    QueryScratchLease lease;
+    QueryScratch& scratch = lease.Get();
+    scratch.control = control;
+    scratch.after = after;
+    scratch.top_count = top_count;
+
+    ParseQuery(raw_query, scratch.words, scratch.query);
+    GetTermPostings(scratch.query.plus_words, statistics, scratch.plus_postings, max_edit_distance_);
+    // minus words exclude documents regardless of their frequency
+    GetTermPostings(scratch.query.minus_words, nullptr, scratch.minus_postings);
+    if (scratch.plus_postings.empty()) {
+        return {};
+    }
+
+    // results found with statistics of a bigger collection depend on more than the index
+    QueryCache* cache = nullptr;
+    if constexpr (IS_INDEXED_COMPARATOR<Comparator>) {
+        if (statistics == nullptr && after == nullptr && top_count == MAX_RESULT_DOCUMENT_COUNT) {
+            cache = query_cache_.Get();
+        }
+    }
+
+    std::vector<Document> documents;
+    if (cache != nullptr) {
+        MakeQueryCacheKey(scratch.plus_postings, scratch.minus_postings, comparator, scratch.cache_key);
+
+        if (cache->Find(scratch.cache_key, epoch_, documents)) {
+            return documents;
+        }
+    }
+
+    const ExecutionPlan plan = PlanQuery(scratch.plus_postings, scratch.minus_postings,
+                                         ComputeWorkerCount<ExecutionPolicy>(scratch.plus_postings));
+    if (plan.exclusion == ExclusionStrategy::BEFORE_SCORING) {
+        BuildExclusion(scratch.minus_postings, scratch.excluded);
+    } else {
+        scratch.excluded.Clear();
+    }
+
+    if (plan.scoring == ScoringStrategy::DOCUMENT_AT_A_TIME) {
+        documents = FindTopDocumentsDocumentAtATime(scratch, plan, comparator);
+    } else {
+        FindAllDocuments(policy, scratch, plan, comparator);
+        std::vector<Document>& matched_documents = scratch.documents;
+        if (after != nullptr) {
+            matched_documents.erase(std::remove_if(matched_documents.begin(), matched_documents.end(), [after](const Document& document) {
+                                        return !IsMoreRelevant(*after, document);
+                                    }),
+                                    matched_documents.end());
+        }
+
+        // only the top of the result is needed, so there is no reason to sort all of it
+        const size_t result_count = std::min(matched_documents.size(), top_count);
+        std::partial_sort(
+            policy,
+            matched_documents.begin(), matched_documents.begin() + result_count, matched_documents.end(),
+            IsMoreRelevant);
+
+        documents.assign(matched_documents.begin(), matched_documents.begin() + result_count);
+    }
 
-    std::sort(
+    // a query stopped before its end has a partial result
+    if (cache != nullptr && (control == nullptr || control->GetStatus() == QueryStatus::COMPLETE)) {
+        cache->Insert(scratch.cache_key, epoch_, documents);
+    }
+
+    return documents;
+}
+
+template <typename Comparator>
+SearchPage SearchServer::FindTopDocuments(std::string_view raw_query, size_t page_size, const SearchCursor& cursor,
+                                          Comparator comparator) const {
+    using namespace std::string_literals;
+
+    if (page_size == 0) {
+        throw std::invalid_argument("Page size must be positive"s);
+    }
+
+    SearchPage page;
+    page.documents = FindTopDocumentsWithStatistics(std::execution::seq, raw_query, comparator, nullptr, nullptr,
+                                                    cursor.IsStart() ? nullptr : &cursor.GetLastDocument(), page_size);
+    page.next_cursor = page.documents.empty() ? cursor : SearchCursor(page.documents.back());
+
+    return page;
+}
+
+template <typename Comparator>
+void SearchServer::MakeQueryCacheKey(const std::vector<TermPostings>& plus_postings, const std::vector<TermPostings>& minus_postings,
+                                     Comparator comparator, QueryCacheKey& key) {
+    key.plus_term_ids.clear();
+    bool has_similar_terms = false;
+    for (const TermPostings& term : plus_postings) {
+        key.plus_term_ids.push_back(term.term_id);
+        has_similar_terms = has_similar_terms || term.edit_distance > 0;
+    }
+    std::sort(key.plus_term_ids.begin(), key.plus_term_ids.end());
+
+    // the same terms weigh differently when other words are typed
+    key.plus_edit_distances.clear();
+    if (has_similar_terms) {
+        key.plus_edit_distances.resize(key.plus_term_ids.size());
+        for (const TermPostings& term : plus_postings) {
+            const auto position = std::lower_bound(key.plus_term_ids.begin(), key.plus_term_ids.end(), term.term_id);
+            key.plus_edit_distances[position - key.plus_term_ids.begin()] = static_cast<uint8_t>(term.edit_distance);
+        }
+    }
+
+    key.minus_term_ids.clear();
+    for (const TermPostings& term : minus_postings) {
+        key.minus_term_ids.push_back(term.term_id);
+    }
+    std::sort(key.minus_term_ids.begin(), key.minus_term_ids.end());
+
+    if constexpr (std::is_same_v<Comparator, ByStatus>) {
+        key.comparator_kind = 0;
+        key.comparator_value = static_cast<int>(comparator.status);
+    } else if constexpr (std::is_same_v<Comparator, ByMinRating>) {
+        key.comparator_kind = 1;
+        key.comparator_value = comparator.min_rating;
+    }
+}
+
+template <typename ExecutionPolicy>
+std::vector<std::vector<Document>> SearchServer::FindTopDocumentsInBatch(ExecutionPolicy&& policy,
+                                                                         const std::vector<std::string>& queries) const {
+    // queries are parsed here, so an invalid one throws before any worker has started
+    std::vector<BatchQuery> batch_queries;
+    batch_queries.reserve(queries.size());
+    for (const std::string& query : queries) {
+        batch_queries.push_back(MakeBatchQuery(query));
+    }
+
+    std::vector<size_t> repeated_queries;
+    const std::vector<std::vector<size_t>> groups = GroupBatchQueries(batch_queries, repeated_queries);
+    std::vector<std::vector<Document>> results(queries.size());
+    std::for_each(
         policy,
-        matched_documents.begin(), matched_documents.end(),
-        [](const Document& lhs, const Document& rhs) {
-            if (std::abs(lhs.relevance - rhs.relevance) < EPS) {
-                return lhs.rating > rhs.rating;
-            } else {
-                return lhs.relevance > rhs.relevance;
-            }
+        groups.begin(), groups.end(),
+        [&](const std::vector<size_t>& group) {
+            FindTopDocumentsInGroup(queries, batch_queries, group, results);
         });
 
-    if (matched_documents.size() > MAX_RESULT_DOCUMENT_COUNT) {
-        matched_documents.resize(MAX_RESULT_DOCUMENT_COUNT);
+    for (size_t query = 0; query < queries.size(); ++query) {
+        if (repeated_queries[query] != query) {
+            results[query] = results[repeated_queries[query]];
+        }
     }
 
-    return matched_documents;
+    return results;
+}
+
+template <typename Comparator>
+QueryHandle SearchServer::FindTopDocumentsAsync(QueryExecutor& executor, std::string_view raw_query, Comparator comparator,
+                                                std::chrono::steady_clock::time_point deadline) const {
+    auto control = std::make_shared<QueryControl>(deadline);
+
+    std::future<AsyncQueryResult> result = executor.Submit([this, query = std::string(raw_query), comparator, control]() {
+        // a query which waited in the queue past its deadline isn't started
+        if (control->ShouldStop()) {
+            return AsyncQueryResult{{}, control->GetStatus()};
+        }
+
+        std::vector<Document> documents = FindTopDocumentsWithStatistics(std::execution::seq, query, comparator, nullptr, control.get());
+        return AsyncQueryResult{std::move(documents), control->GetStatus()};
+    });
+
+    return QueryHandle(std::move(result), std::move(control));
+}
+
+template <typename ExecutionPolicy>
+QueryPlan SearchServer::ExplainQuery(ExecutionPolicy&&, std::string_view raw_query) const {
+    // planning itself is sequential, only the policy's type matters: it decides how many workers the plan has
+    const Query query = ParseQuery(raw_query);
+    std::vector<TermPostings> plus_postings;
+    std::vector<TermPostings> minus_postings;
+    GetTermPostings(query.plus_words, nullptr, plus_postings, max_edit_distance_);
+    GetTermPostings(query.minus_words, nullptr, minus_postings);
+
+    const ExecutionPlan plan = PlanQuery(plus_postings, minus_postings, ComputeWorkerCount<ExecutionPolicy>(plus_postings));
+
+    return MakeQueryPlan(query, plus_postings, minus_postings, plan);
 }
 
 template <typename ExecutionPolicy>
@@ -161,9 +948,7 @@ std::vector<Document> SearchServer::FindTopDocuments(ExecutionPolicy&& policy, s
 
 template <typename ExecutionPolicy>
 std::vector<Document> SearchServer::FindTopDocuments(ExecutionPolicy&& policy, std::string_view raw_query, DocumentStatus status) const {
-    return FindTopDocuments(policy, raw_query, [status](int document_id, DocumentStatus stat, int rating) {
-        return stat == status;
-    });
+    return FindTopDocuments(policy, raw_query, ByStatus{status});
 }
 
 template <typename Comparator>
@@ -173,111 +958,447 @@ std::vector<Document> SearchServer::FindTopDocuments(std::string_view raw_query,
 
 template <typename ExecutionPolicy>
 std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDocument(
-    ExecutionPolicy&& policy, std::string_view raw_query, int document_id) const {
-    const Query query = ParseQuery(raw_query);
-    std::vector<std::string_view> match_words(query.plus_words.size());
+    ExecutionPolicy&&, std::string_view raw_query, int document_id) const {
+    // the policy is accepted only for source compatibility: the intersection with a single document's
+    // terms is too short to split between threads, MatchDocuments runs documents in parallel
+    const MatchTerms terms = GetMatchTerms(raw_query);
 
-    std::function<bool(const std::pair<int, double>&)> check_equal_doc_id = [&document_id](const auto& kv) {
-        return kv.first == document_id;
-    };
+    return MatchOrdinal(terms, id_to_ordinal_.at(document_id));
+}
 
-    std::atomic_int size = 0;
-    std::for_each(
+template <typename ExecutionPolicy>
+std::vector<std::tuple<std::vector<std::string_view>, DocumentStatus>> SearchServer::MatchDocuments(
+    ExecutionPolicy&& policy, std::string_view raw_query, const std::vector<int>& document_ids) const {
+    const MatchTerms terms = GetMatchTerms(raw_query);
+
+    // an absent document throws here, before any worker has started
+    std::vector<uint32_t> ordinals;
+    ordinals.reserve(document_ids.size());
+    for (const int document_id : document_ids) {
+        ordinals.push_back(id_to_ordinal_.at(document_id));
+    }
+
+    std::vector<std::tuple<std::vector<std::string_view>, DocumentStatus>> matches(ordinals.size());
+    std::transform(
         policy,
-        query.plus_words.begin(), query.plus_words.end(),
-        [&](std::string_view word) {
-            // to create a string_view we should use a string that will not die after outing out
-            // of scope (so we use "word_s" below)
-            auto it = word_to_document_freqs_.find(std::string(word));
-            const auto& word_s = it->first;
-            const auto& doc_freqs = it->second;
-
-            int count_doc_id = count_if(
-                policy,
-                doc_freqs.begin(), doc_freqs.end(),
-                check_equal_doc_id);
-
-            if (count_doc_id) {
-                match_words[size++] = std::string_view(word_s);
-            }
+        ordinals.begin(), ordinals.end(), matches.begin(),
+        [this, &terms](uint32_t ordinal) {
+            return MatchOrdinal(terms, ordinal);
         });
-    match_words.resize(size);
 
-    bool should_clear_matched_words = std::any_of(
+    return matches;
+}
+
+template <typename ExecutionPolicy>
+std::vector<int> SearchServer::FindDuplicates(ExecutionPolicy&& policy, double min_similarity) const {
+    using namespace std::string_literals;
+
+    if (!(min_similarity > 0.0 && min_similarity <= 1.0)) {
+        throw std::invalid_argument("Min similarity must be in (0, 1]"s);
+    }
+
+    // documents go by id, so of two duplicates the one with the smaller position is kept
+    std::vector<uint32_t> ordinals;
+    ordinals.reserve(document_ids_.size());
+    for (const int document_id : document_ids_) {
+        ordinals.push_back(id_to_ordinal_.at(document_id));
+    }
+
+    // every duplicate is joined to the smallest position of its chain
+    std::vector<size_t> parents(ordinals.size());
+    std::iota(parents.begin(), parents.end(), 0);
+    const auto find_root = [&parents](size_t position) {
+        while (parents[position] != position) {
+            position = parents[position] = parents[parents[position]];
+        }
+        return position;
+    };
+    const auto join = [&](size_t lhs, size_t rhs) {
+        const size_t lhs_root = find_root(lhs);
+        const size_t rhs_root = find_root(rhs);
+        parents[std::max(lhs_root, rhs_root)] = std::min(lhs_root, rhs_root);
+    };
+
+    // (fingerprint, position): documents with the same terms are next to each other after sorting
+    std::vector<std::pair<uint64_t, size_t>> fingerprints(ordinals.size());
+    std::vector<size_t> positions(ordinals.size());
+    std::iota(positions.begin(), positions.end(), 0);
+    std::transform(
         policy,
-        query.minus_words.begin(), query.minus_words.end(),
-        [&](std::string_view word) {
-            const std::map<int, double>& doc_freqs = word_to_document_freqs_.at(std::string(word));
-            return doc_freqs.count(document_id) > 0u;
+        positions.begin(), positions.end(), fingerprints.begin(),
+        [&](size_t position) {
+            return std::make_pair(ComputeFingerprint(ordinals[position]), position);
         });
-    if (should_clear_matched_words) {
-        match_words.clear();
+    std::sort(policy, fingerprints.begin(), fingerprints.end());
+
+    for (size_t run_begin = 0; run_begin < fingerprints.size();) {
+        size_t run_end = run_begin + 1;
+        for (; run_end < fingerprints.size() && fingerprints[run_end].first == fingerprints[run_begin].first; ++run_end) {
+            // a fingerprint collision isn't a duplicate, though there is hardly going to be one
+            for (size_t i = run_begin; i < run_end; ++i) {
+                if (HasSameTerms(ordinals[fingerprints[i].second], ordinals[fingerprints[run_end].second])) {
+                    join(fingerprints[i].second, fingerprints[run_end].second);
+                    break;
+                }
+            }
+        }
+
+        run_begin = run_end;
+    }
+
+    if (min_similarity < 1.0) {
+        std::vector<uint64_t> signatures(ordinals.size() * MINHASH_SIZE);
+        std::for_each(
+            policy,
+            positions.begin(), positions.end(),
+            [&](size_t position) {
+                ComputeMinHash(ordinals[position], signatures.data() + position * MINHASH_SIZE);
+            });
+
+        // every band is bucketed on its own, and gives pairs of similar documents
+        std::vector<size_t> bands(MINHASH_BAND_COUNT);
+        std::iota(bands.begin(), bands.end(), 0);
+        std::vector<std::vector<std::pair<size_t, size_t>>> similar_pairs(MINHASH_BAND_COUNT);
+        std::for_each(
+            policy,
+            bands.begin(), bands.end(),
+            [&](size_t band) {
+                std::vector<std::pair<uint64_t, size_t>> buckets(ordinals.size());
+                for (size_t position = 0; position < ordinals.size(); ++position) {
+                    const uint64_t* rows = signatures.data() + position * MINHASH_SIZE + band * MINHASH_BAND_SIZE;
+                    uint64_t bucket = band;
+                    for (size_t row = 0; row < MINHASH_BAND_SIZE; ++row) {
+                        bucket = bucket * 0x100000001b3 ^ rows[row];
+                    }
+
+                    buckets[position] = {bucket, position};
+                }
+                std::sort(buckets.begin(), buckets.end());
+
+                for (size_t i = 1; i < buckets.size(); ++i) {
+                    for (size_t j = i; j-- > 0 && i - j <= MAX_BUCKET_COMPARISONS && buckets[j].first == buckets[i].first;) {
+                        const size_t lhs = buckets[j].second;
+                        const size_t rhs = buckets[i].second;
+
+                        if (ComputeJaccardSimilarity(ordinals[lhs], ordinals[rhs]) >= min_similarity - EPS) {
+                            similar_pairs[band].emplace_back(lhs, rhs);
+                        }
+                    }
+                }
+            });
+
+        for (const std::vector<std::pair<size_t, size_t>>& pairs : similar_pairs) {
+            for (const auto& [lhs, rhs] : pairs) {
+                join(lhs, rhs);
+            }
+        }
+    }
+
+    std::vector<int> duplicate_ids;
+    for (size_t position = 0; position < ordinals.size(); ++position) {
+        if (find_root(position) != position) {
+            duplicate_ids.push_back(ordinal_to_id_[ordinals[position]]);
+        }
+    }
+
+    return duplicate_ids;
+}
+
+template <typename Comparator>
+bool SearchServer::IsAccepted(Comparator& comparator, uint32_t ordinal) const {
+    // status bitmaps have no tombstoned documents, other comparators have to skip them
+    if constexpr (std::is_same_v<Comparator, ByStatus>) {
+        return status_bitmaps_[static_cast<size_t>(comparator.status)].Test(ordinal);
+    } else if constexpr (std::is_same_v<Comparator, ByMinRating>) {
+        return ratings_[ordinal] >= comparator.min_rating && !tombstones_.Test(ordinal);
+    } else {
+        return !tombstones_.Test(ordinal) &&
+               comparator(ordinal_to_id_[ordinal], static_cast<DocumentStatus>(statuses_[ordinal]), ratings_[ordinal]);
+    }
+}
+
+template <typename Comparator>
+bool SearchServer::IsAccepted(DeletionFilter<Comparator>& filter, uint32_t ordinal) const {
+    return !filter.deletions->Contains(ordinal) && IsAccepted(filter.comparator, ordinal);
+}
+
+template <typename ExecutionPolicy>
+size_t SearchServer::ComputeWorkerCount(const std::vector<TermPostings>& term_postings) {
+    if constexpr (std::is_same_v<std::decay_t<ExecutionPolicy>, std::execution::sequenced_policy>) {
+        return 1;
+    }
+
+    size_t posting_count = 0;
+    for (const TermPostings& term : term_postings) {
+        posting_count += term.postings->GetSize();
     }
 
-    return std::make_tuple(match_words, document_ratings_status_.at(document_id).status);
+    const size_t thread_count = std::max(std::thread::hardware_concurrency(), 1u);
+
+    return std::clamp(posting_count / MIN_POSTINGS_PER_WORKER, static_cast<size_t>(1), thread_count);
+}
+
+// [begin, end) is a range of posting blocks of all the terms taken one after another
+template <typename Comparator>
+void SearchServer::AccumulateScores(const std::vector<TermPostings>& term_postings, size_t begin, size_t end,
+                                    const RoaringBitmap& excluded, Comparator comparator, QueryControl* control,
+                                    ScoreAccumulator& accumulator) const {
+    const bool has_excluded = !excluded.IsEmpty();
+    uint32_t ordinals[PostingList::BLOCK_SIZE];
+    uint32_t term_counts[PostingList::BLOCK_SIZE];
+    double scores[PostingList::BLOCK_SIZE];
+    size_t offset = 0;
+
+    for (const auto& [term_id, postings, inverse_document_freq, edit_distance] : term_postings) {
+        const size_t first = std::max(begin, offset);
+        const size_t last = std::min(end, offset + postings->GetBlockCount());
+        // the ordinals of a term ascend, so the exclusion is checked without searching it anew
+        RoaringBitmap::SortedLookup excluded_lookup(excluded);
+
+        for (size_t block = first; block < last; ++block) {
+            if (control != nullptr && control->ShouldStop()) {
+                return;
+            }
+
+            const size_t block_size = postings->DecodeBlock(block - offset, ordinals, term_counts);
+
+            // postings of documents the query rejects are dropped, and the rest are scored at once
+            size_t kept_count = 0;
+            for (size_t i = 0; i < block_size; ++i) {
+                const uint32_t ordinal = ordinals[i];
+                bool is_kept = !has_excluded || !excluded_lookup.Contains(ordinal);
+
+                if constexpr (IS_INDEXED_COMPARATOR<Comparator>) {
+                    is_kept = is_kept && IsAccepted(comparator, ordinal);
+                } else if (is_kept && accumulator.IsRejected(ordinal)) {
+                    is_kept = false;
+                } else if (is_kept && !accumulator.IsMatched(ordinal) && !IsAccepted(comparator, ordinal)) {
+                    // a document met in the postings of the next terms isn't checked again
+                    accumulator.Reject(ordinal);
+                    is_kept = false;
+                }
+
+                ordinals[kept_count] = ordinal;
+                term_counts[kept_count] = term_counts[i];
+                kept_count += is_kept ? 1 : 0;
+            }
+
+            ComputeScores(ordinals, term_counts, kept_count, inv_word_counts_.data(), inverse_document_freq, scores);
+            for (size_t i = 0; i < kept_count; ++i) {
+                accumulator.Add(ordinals[i], scores[i]);
+            }
+        }
+
+        offset += postings->GetBlockCount();
+    }
 }
 
 template <typename ExecutionPolicy, typename Comparator>
-std::vector<Document> SearchServer::FindAllDocuments(ExecutionPolicy&& policy, const Query& query, Comparator comparator) const {
-    ConcurrentMap<int, double> concurr_map(4);
+void SearchServer::FindAllDocuments(ExecutionPolicy&& policy, QueryScratch& scratch, const ExecutionPlan& plan,
+                                    Comparator comparator) const {
+    const std::vector<TermPostings>& plus_postings = scratch.plus_postings;
+    const RoaringBitmap& excluded = scratch.excluded;
+    const size_t worker_count = plan.worker_count;
+    const auto is_excluded = [&](uint32_t ordinal) {
+        return plan.exclusion == ExclusionStrategy::CANDIDATE_LOOKUP && HasAnyTerm(ordinal, scratch.minus_postings);
+    };
+    std::vector<Document>& matched_documents = scratch.documents;
+    matched_documents.clear();
+
+    if (worker_count == 1) {
+        ScoreAccumulator& accumulator = scratch.accumulator;
+        accumulator.Reset(ordinal_to_id_.size());
+        AccumulateScores(plus_postings, 0, SIZE_MAX, excluded, comparator, scratch.control, accumulator);
+
+        for (const uint32_t ordinal : accumulator.GetTouched()) {
+            if (accumulator.IsMatched(ordinal) && !is_excluded(ordinal)) {
+                matched_documents.push_back(MakeDocument(ordinal, accumulator.GetScore(ordinal)));
+            }
+        }
+
+        return;
+    }
+
+    // every worker scores its own equal share of posting blocks into a private accumulator, so
+    // there is nothing to lock; then accumulators are summed up in parallel by ordinal chunks
+    size_t block_count = 0;
+    for (const TermPostings& term : plus_postings) {
+        block_count += term.postings->GetBlockCount();
+    }
+
+    std::vector<ScoreAccumulator> accumulators;
+    accumulators.reserve(worker_count);
+    for (size_t i = 0; i < worker_count; ++i) {
+        accumulators.emplace_back(ordinal_to_id_.size());
+    }
 
+    std::vector<size_t> workers(worker_count);
+    std::iota(workers.begin(), workers.end(), 0);
     std::for_each(
         policy,
-        query.plus_words.begin(), query.plus_words.end(),
-        [&](std::string_view word_v) {
-            std::string word(word_v);
-            if (word_to_document_freqs_.count(word)) {
-                const double inverse_document_freq = ComputeWordInverseDocumentFreq(word);
-
-                const auto& doc_freqs = word_to_document_freqs_.at(word);
-                std::for_each(
-                    policy,
-                    doc_freqs.begin(), doc_freqs.end(),
-                    [&](const auto& kv) {
-                        auto& [document_id, term_freq] = kv;
-
-                        Document document_data = document_ratings_status_.at(document_id);
-
-                        bool should_add_document = comparator(
-                            document_id,
-                            document_data.status,
-                            document_data.rating);
-
-                        if (should_add_document) {
-                            concurr_map[document_id].ref_to_value += term_freq * inverse_document_freq;
-                        }
-                    });
-            }
+        workers.begin(), workers.end(),
+        [&](size_t worker) {
+            AccumulateScores(plus_postings, block_count * worker / worker_count,
+                             block_count * (worker + 1) / worker_count, excluded, comparator, scratch.control, accumulators[worker]);
         });
 
-    std::map<int, double> document_to_relevance;
-    document_to_relevance = concurr_map.BuildOrdinaryMap();
-    std::mutex m;  // erasing from document_to_relevance
-
+    std::vector<std::vector<Document>> chunk_documents((ordinal_to_id_.size() + REDUCE_CHUNK_SIZE - 1) / REDUCE_CHUNK_SIZE);
+    std::vector<size_t> chunks(chunk_documents.size());
+    std::iota(chunks.begin(), chunks.end(), 0);
     std::for_each(
         policy,
-        query.minus_words.begin(), query.minus_words.end(),
-        [&](std::string_view word_v) {
-            std::string word(word_v);
-
-            if (word_to_document_freqs_.count(word)) {
-                for (const auto& [document_id, _] : word_to_document_freqs_.at(word)) {
-                    std::lock_guard guard(m);
-                    document_to_relevance.erase(document_id);
+        chunks.begin(), chunks.end(),
+        [&](size_t chunk) {
+            const size_t last = std::min(ordinal_to_id_.size(), (chunk + 1) * REDUCE_CHUNK_SIZE);
+
+            for (size_t ordinal = chunk * REDUCE_CHUNK_SIZE; ordinal < last; ++ordinal) {
+                bool is_matched = false;
+                double relevance = 0.0;
+
+                for (const ScoreAccumulator& accumulator : accumulators) {
+                    is_matched |= accumulator.IsMatched(ordinal);
+                    relevance += accumulator.GetScore(ordinal);
+                }
+
+                if (is_matched && !is_excluded(ordinal)) {
+                    chunk_documents[chunk].push_back(MakeDocument(ordinal, relevance));
                 }
             }
         });
 
-    std::vector<Document> matched_documents(document_to_relevance.size());
-    std::transform(
-        policy,
-        document_to_relevance.begin(), document_to_relevance.end(),
-        matched_documents.begin(),
-        [&](const auto& kv) {
-            Document document_data = document_ratings_status_.at(kv.first);
+    for (std::vector<Document>& documents : chunk_documents) {
+        matched_documents.insert(matched_documents.end(), documents.begin(), documents.end());
+    }
+}
 
-            return Document(kv.first, kv.second, document_data.rating, document_data.status);
-        });
+template <typename Comparator>
+std::vector<Document> SearchServer::FindTopDocumentsDocumentAtATime(QueryScratch& scratch, const ExecutionPlan& plan,
+                                                                    Comparator comparator) const {
+    std::vector<TermCursor>& terms = scratch.terms;
+    terms.clear();
+    for (const auto& [term_id, postings, inverse_document_freq, edit_distance] : scratch.plus_postings) {
+        terms.push_back({PostingList::Cursor(*postings), inverse_document_freq,
+                         postings->GetMaxTermFreq() * inverse_document_freq});
+    }
+    std::sort(terms.begin(), terms.end(), [](const TermCursor& lhs, const TermCursor& rhs) {
+        return lhs.max_score < rhs.max_score;
+    });
+
+    // max_score_prefix[i] bounds the score a document gets from terms [0, i]
+    std::vector<double>& max_score_prefix = scratch.max_score_prefix;
+    max_score_prefix.clear();
+    double max_score_sum = 0.0;
+    for (const TermCursor& term : terms) {
+        max_score_sum += term.max_score;
+        max_score_prefix.push_back(max_score_sum);
+    }
+
+    const RoaringBitmap& excluded = scratch.excluded;
+    const bool has_excluded = !excluded.IsEmpty();
+    // candidates come in ascending order of ordinals
+    RoaringBitmap::SortedLookup excluded_lookup(excluded);
+    // looked up only for documents which get into the top
+    const bool is_lookup_needed = plan.exclusion == ExclusionStrategy::CANDIDATE_LOOKUP;
+    const Document* const after = scratch.after;
+    TopDocuments top_documents(scratch.top_count);
+    // a document with a score lower than the threshold by EPS loses to every document in the full top
+    double threshold = -std::numeric_limits<double>::infinity();
+    // terms before the first essential one can't lift a document into the top by themselves,
+    // so only essential terms give candidates
+    size_t first_essential = 0;
+    size_t until_stop_check = STOP_CHECK_INTERVAL;
+
+    while (true) {
+        if (scratch.control != nullptr && --until_stop_check == 0) {
+            if (scratch.control->ShouldStop()) {
+                break;
+            }
+            until_stop_check = STOP_CHECK_INTERVAL;
+        }
+
+        uint32_t ordinal = UINT32_MAX;
+        for (size_t i = first_essential; i < terms.size(); ++i) {
+            if (!terms[i].cursor.IsEnd()) {
+                ordinal = std::min(ordinal, terms[i].cursor.GetOrdinal());
+            }
+        }
+        if (ordinal == UINT32_MAX) {
+            break;
+        }
+
+        // an excluded document isn't scored, its postings are only stepped over
+        const bool is_excluded = has_excluded && excluded_lookup.Contains(ordinal);
+        double score = 0.0;
+        for (size_t i = first_essential; i < terms.size(); ++i) {
+            PostingList::Cursor& cursor = terms[i].cursor;
+
+            if (!cursor.IsEnd() && cursor.GetOrdinal() == ordinal) {
+                if (!is_excluded) {
+                    score += cursor.GetTermCount() * inv_word_counts_[ordinal] * terms[i].inverse_document_freq;
+                }
+                cursor.Next();
+            }
+        }
+        if (is_excluded) {
+            continue;
+        }
+
+        if (!IsAccepted(comparator, ordinal)) {
+            continue;
+        }
+
+        if (first_essential > 0) {
+            // block maxima are much tighter than list maxima and cost no posting reads
+            double bound = score;
+            for (size_t i = 0; i < first_essential; ++i) {
+                bound += terms[i].cursor.SeekBlock(ordinal) * terms[i].inverse_document_freq;
+            }
+            if (bound < threshold - EPS) {
+                continue;
+            }
+
+            bool is_pruned = false;
+            for (size_t i = first_essential; i-- > 0;) {
+                if (score + max_score_prefix[i] < threshold - EPS) {
+                    is_pruned = true;
+                    break;
+                }
+
+                PostingList::Cursor& cursor = terms[i].cursor;
+                cursor.Seek(ordinal);
+                if (!cursor.IsEnd() && cursor.GetOrdinal() == ordinal) {
+                    score += cursor.GetTermCount() * inv_word_counts_[ordinal] * terms[i].inverse_document_freq;
+                }
+            }
+            if (is_pruned) {
+                continue;
+            }
+        }
+
+        // documents of the previous pages are scored to be told apart, but never kept
+        if (after != nullptr && score > after->relevance + EPS) {
+            continue;
+        }
+
+        if (is_lookup_needed && HasAnyTerm(ordinal, scratch.minus_postings)) {
+            continue;
+        }
+
+        const Document document = MakeDocument(ordinal, score);
+        if (after != nullptr && !IsMoreRelevant(*after, document)) {
+            continue;
+        }
+
+        top_documents.Push(document);
+
+        if (top_documents.IsFull()) {
+            threshold = top_documents.GetWorst().relevance;
+
+            while (first_essential < terms.size() && max_score_prefix[first_essential] < threshold - EPS) {
+                ++first_essential;
+            }
+        }
+    }
 
-    return matched_documents;
+    return top_documents.Extract();
 }
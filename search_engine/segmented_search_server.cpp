@@ -0,0 +1,257 @@
+#include "segmented_search_server.h"
+
+#include <algorithm>
+#include <array>
+#include <execution>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "document.h"
+#include "search_server.h"
+
+using namespace std::string_literals;
+
+SegmentedSearchServer::SegmentedSearchServer(std::string_view stop_words, size_t segment_document_count)
+    : stop_words_(stop_words),
+      segment_document_count_(segment_document_count),
+      query_parser_(stop_words_),
+      snapshot_(std::make_shared<const Snapshot>()),
+      buffer_(stop_words_) {
+    merge_thread_ = std::thread([this]() {
+        RunMerges();
+    });
+}
+
+SegmentedSearchServer::~SegmentedSearchServer() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        is_stopping_ = true;
+    }
+
+    merge_condition_.notify_all();
+    merge_thread_.join();
+}
+
+void SegmentedSearchServer::AddDocument(int document_id, std::string_view document, DocumentStatus status,
+                                        const std::vector<int>& ratings) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    if (document_segments_.count(document_id)) {
+        throw std::invalid_argument("Document with such id has already added"s);
+    }
+
+    buffer_.AddDocument(document_id, document, status, ratings);
+    document_segments_[document_id] = &buffer_;
+
+    if (buffer_.GetDocumentCount() >= static_cast<int>(segment_document_count_)) {
+        RefreshLocked();
+    }
+}
+
+void SegmentedSearchServer::RemoveDocument(int document_id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    const auto document_segment = document_segments_.find(document_id);
+    if (document_segment == document_segments_.end()) {
+        return;
+    }
+
+    const SearchServer* index = document_segment->second;
+    document_segments_.erase(document_segment);
+
+    if (index == &buffer_) {
+        buffer_.RemoveDocument(document_id);
+        return;
+    }
+
+    // sealed segments are never changed, the document is hidden from queries instead
+    std::vector<Segment> segments = GetSnapshot()->segments;
+    for (Segment& segment : segments) {
+        if (segment.index.get() == index) {
+            segment.deletions = index->DeleteDocuments(segment.deletions, std::array{document_id});
+            break;
+        }
+    }
+
+    // the merged segment has the document yet
+    if (std::find(merging_indexes_.begin(), merging_indexes_.end(), index) != merging_indexes_.end()) {
+        removed_while_merging_.push_back(document_id);
+    }
+
+    PublishSnapshot(std::move(segments));
+}
+
+void SegmentedSearchServer::Refresh() {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    RefreshLocked();
+}
+
+void SegmentedSearchServer::Merge() {
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    RefreshLocked();
+    merge_condition_.wait(lock, [this]() {
+        return !is_merging_;
+    });
+
+    const std::vector<Segment> segments = GetSnapshot()->segments;
+    if (segments.size() > 1u || (segments.size() == 1u && segments.front().deletions.GetDocumentCount() > 0u)) {
+        MergeSegments(lock, segments);
+    }
+}
+
+std::vector<Document> SegmentedSearchServer::FindTopDocuments(std::string_view raw_query, DocumentStatus status) const {
+    return FindTopDocuments(raw_query, ByStatus{status});
+}
+
+std::vector<Document> SegmentedSearchServer::FindTopDocuments(std::string_view raw_query) const {
+    return FindTopDocuments(raw_query, DocumentStatus::ACTUAL);
+}
+
+int SegmentedSearchServer::GetDocumentCount() const {
+    int document_count = 0;
+
+    for (const Segment& segment : GetSnapshot()->segments) {
+        document_count += segment.GetDocumentCount();
+    }
+
+    return document_count;
+}
+
+size_t SegmentedSearchServer::GetSegmentCount() const {
+    return GetSnapshot()->segments.size();
+}
+
+int SegmentedSearchServer::Segment::GetDocumentCount() const {
+    return index->GetDocumentCount() - static_cast<int>(deletions.GetDocumentCount());
+}
+
+std::shared_ptr<const SegmentedSearchServer::Snapshot> SegmentedSearchServer::GetSnapshot() const {
+    return std::atomic_load(&snapshot_);
+}
+
+void SegmentedSearchServer::PublishSnapshot(std::vector<Segment> segments) {
+    std::shared_ptr<const Snapshot> snapshot = std::make_shared<const Snapshot>(Snapshot{std::move(segments)});
+
+    std::atomic_store(&snapshot_, std::move(snapshot));
+}
+
+void SegmentedSearchServer::RefreshLocked() {
+    if (buffer_.GetDocumentCount() == 0) {
+        return;
+    }
+
+    std::shared_ptr<const SearchServer> index = std::make_shared<const SearchServer>(std::move(buffer_));
+    buffer_ = SearchServer(stop_words_);
+
+    for (const int document_id : *index) {
+        document_segments_[document_id] = index.get();
+    }
+
+    std::vector<Segment> segments = GetSnapshot()->segments;
+    segments.push_back({std::move(index), DeletionSet()});
+    PublishSnapshot(std::move(segments));
+
+    if (NeedsMerge()) {
+        merge_condition_.notify_all();
+    }
+}
+
+bool SegmentedSearchServer::NeedsMerge() const {
+    return !is_merging_ && GetSnapshot()->segments.size() > MAX_SEGMENT_COUNT;
+}
+
+void SegmentedSearchServer::RunMerges() {
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    while (true) {
+        merge_condition_.wait(lock, [this]() {
+            return is_stopping_ || NeedsMerge();
+        });
+
+        if (is_stopping_) {
+            return;
+        }
+
+        // merging the smallest segments keeps every document from being rewritten too many times
+        std::vector<Segment> segments = GetSnapshot()->segments;
+        std::sort(segments.begin(), segments.end(), [](const Segment& lhs, const Segment& rhs) {
+            return lhs.GetDocumentCount() < rhs.GetDocumentCount();
+        });
+        segments.resize(MERGE_FACTOR);
+
+        MergeSegments(lock, std::move(segments));
+    }
+}
+
+void SegmentedSearchServer::MergeSegments(std::unique_lock<std::mutex>& lock, std::vector<Segment> segments) {
+    is_merging_ = true;
+    merging_indexes_.clear();
+    for (const Segment& segment : segments) {
+        merging_indexes_.push_back(segment.index.get());
+    }
+    lock.unlock();
+
+    // segments are immutable, so they are read while writers go on; deleted documents are skipped
+    std::shared_ptr<SearchServer> merged_index = std::make_shared<SearchServer>(stop_words_);
+    for (const Segment& segment : segments) {
+        merged_index->CopyDocuments(*segment.index, segment.deletions);
+    }
+
+    lock.lock();
+    is_merging_ = false;
+
+    // documents removed while merging are in the merged segment yet, they are deleted in one batch
+    Segment merged{merged_index, merged_index->DeleteDocuments(DeletionSet(), removed_while_merging_)};
+    merging_indexes_.clear();
+    removed_while_merging_.clear();
+
+    std::vector<Segment> result;
+    for (const Segment& segment : GetSnapshot()->segments) {
+        const bool is_merged = std::any_of(segments.begin(), segments.end(), [&segment](const Segment& merged_segment) {
+            return merged_segment.index == segment.index;
+        });
+
+        if (!is_merged) {
+            result.push_back(segment);
+        }
+    }
+
+    for (const int document_id : *merged_index) {
+        const auto document_segment = document_segments_.find(document_id);
+
+        if (document_segment != document_segments_.end()) {
+            document_segment->second = merged_index.get();
+        }
+    }
+
+    result.push_back(std::move(merged));
+    PublishSnapshot(std::move(result));
+
+    // both the waiting Merge and the next background merge may go on now
+    merge_condition_.notify_all();
+}
+
+CollectionStatistics SegmentedSearchServer::ComputeStatistics(const Snapshot& snapshot, std::string_view raw_query) const {
+    // the empty parser validates the query and lists its words
+    CollectionStatistics statistics = query_parser_.GetStatistics(raw_query);
+
+    for (const Segment& segment : snapshot.segments) {
+        // frequencies of a segment don't count its deleted documents
+        const CollectionStatistics segment_statistics = segment.index->GetStatistics(raw_query, segment.deletions);
+        statistics.document_count += segment_statistics.document_count;
+
+        // patterns may match different terms in different segments
+        for (const auto& [word, segment_freq] : segment_statistics.document_freqs) {
+            statistics.document_freqs[word] += segment_freq;
+        }
+    }
+
+    return statistics;
+}
@@ -0,0 +1,126 @@
+#pragma once
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <execution>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "deletion_set.h"
+#include "document.h"
+#include "search_server.h"
+
+const size_t DEFAULT_SEGMENT_DOCUMENT_COUNT = 1 << 12;
+
+// LSM-style index for ingesting documents while serving queries. New documents are collected in a small
+// in-memory buffer which becomes an immutable segment on Refresh (or when it's full), and a background
+// thread merges small segments into bigger ones. Queries read an immutable snapshot of the segment list
+// and never wait for writers or merges; they see documents added before the last Refresh, and removals
+// at once. The relevance is the same as a single SearchServer with the same documents would give
+class SegmentedSearchServer {
+   public:
+    explicit SegmentedSearchServer(std::string_view stop_words, size_t segment_document_count = DEFAULT_SEGMENT_DOCUMENT_COUNT);
+    SegmentedSearchServer(const SegmentedSearchServer&) = delete;
+    SegmentedSearchServer& operator=(const SegmentedSearchServer&) = delete;
+    ~SegmentedSearchServer();
+
+    void AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings);
+    void RemoveDocument(int document_id);
+
+    // makes the added documents visible to queries
+    void Refresh();
+    // refreshes and merges all the segments into one, waiting for the background merge if any
+    void Merge();
+
+    template <typename ExecutionPolicy, typename Comparator>
+    std::vector<Document> FindTopDocuments(ExecutionPolicy&& policy, std::string_view raw_query, Comparator comparator) const;
+    template <typename Comparator>
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, Comparator comparator) const;
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentStatus status) const;
+    std::vector<Document> FindTopDocuments(std::string_view raw_query) const;
+
+    // of the visible documents
+    int GetDocumentCount() const;
+    size_t GetSegmentCount() const;
+
+   private:
+    struct Segment {
+        std::shared_ptr<const SearchServer> index;
+        // documents removed from the immutable index, a removal gives a new set sharing most of the old one
+        DeletionSet deletions;
+
+        int GetDocumentCount() const;
+    };
+
+    struct Snapshot {
+        std::vector<Segment> segments;
+    };
+
+    // merges start when there are more segments, and take this much of the smallest ones
+    static const size_t MAX_SEGMENT_COUNT = 8;
+    static const size_t MERGE_FACTOR = 4;
+
+    const std::string stop_words_;
+    const size_t segment_document_count_;
+    // an empty index to parse queries with, so the empty server rejects the same queries as a full one
+    const SearchServer query_parser_;
+
+    // changed by writers under the mutex and read by queries with atomic_load
+    std::shared_ptr<const Snapshot> snapshot_;
+
+    // guards everything below and publishing of snapshots
+    mutable std::mutex mutex_;
+    SearchServer buffer_;
+    // every added document with its segment, buffered ones point to the buffer
+    std::unordered_map<int, const SearchServer*> document_segments_;
+    bool is_merging_ = false;
+    // indexes of the merged segments, and documents removed from them while the merge goes on
+    std::vector<const SearchServer*> merging_indexes_;
+    std::vector<int> removed_while_merging_;
+    bool is_stopping_ = false;
+    std::condition_variable merge_condition_;
+    std::thread merge_thread_;
+
+    std::shared_ptr<const Snapshot> GetSnapshot() const;
+    void PublishSnapshot(std::vector<Segment> segments);
+
+    void RefreshLocked();
+    bool NeedsMerge() const;
+    void RunMerges();
+    // builds a segment of the given ones without the lock, then replaces them with it
+    void MergeSegments(std::unique_lock<std::mutex>& lock, std::vector<Segment> segments);
+
+    CollectionStatistics ComputeStatistics(const Snapshot& snapshot, std::string_view raw_query) const;
+};
+
+template <typename ExecutionPolicy, typename Comparator>
+std::vector<Document> SegmentedSearchServer::FindTopDocuments(ExecutionPolicy&& policy, std::string_view raw_query,
+                                                              Comparator comparator) const {
+    const std::shared_ptr<const Snapshot> snapshot = GetSnapshot();
+    const CollectionStatistics statistics = ComputeStatistics(*snapshot, raw_query);
+
+    // every segment gives its own top with the common statistics, and the top of them is the answer
+    std::vector<Document> documents;
+    for (const Segment& segment : snapshot->segments) {
+        const std::vector<Document> segment_documents =
+            segment.index->FindTopDocuments(policy, raw_query, comparator, statistics, segment.deletions);
+
+        documents.insert(documents.end(), segment_documents.begin(), segment_documents.end());
+    }
+
+    const size_t top_count = std::min(documents.size(), static_cast<size_t>(MAX_RESULT_DOCUMENT_COUNT));
+    std::partial_sort(documents.begin(), documents.begin() + top_count, documents.end(), IsMoreRelevant);
+    documents.resize(top_count);
+
+    return documents;
+}
+
+template <typename Comparator>
+std::vector<Document> SegmentedSearchServer::FindTopDocuments(std::string_view raw_query, Comparator comparator) const {
+    return FindTopDocuments(std::execution::seq, raw_query, comparator);
+}
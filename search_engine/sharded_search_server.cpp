@@ -0,0 +1,114 @@
+#include "sharded_search_server.h"
+
+#include <execution>
+#include <functional>
+#include <future>
+#include <map>
+#include <stdexcept>
+#include <string_view>
+#include <tuple>
+#include <vector>
+
+#include "document.h"
+#include "search_server.h"
+
+using namespace std::string_literals;
+
+ShardedSearchServer::ShardedSearchServer(std::string_view stop_words, size_t shard_count)
+    : thread_pool_(std::min(shard_count, static_cast<size_t>(std::max(std::thread::hardware_concurrency(), 1u)))) {
+    if (shard_count == 0) {
+        throw std::invalid_argument("Shard count must be positive"s);
+    }
+
+    shards_.reserve(shard_count);
+    for (size_t i = 0; i < shard_count; ++i) {
+        shards_.emplace_back(stop_words);
+    }
+}
+
+void ShardedSearchServer::AddDocument(int document_id, std::string_view document, DocumentStatus status,
+                                      const std::vector<int>& ratings) {
+    // an id always goes to the same shard, so the shard finds repeated ids itself
+    GetShard(document_id).AddDocument(document_id, document, status, ratings);
+}
+
+void ShardedSearchServer::RemoveDocument(int document_id) {
+    RemoveDocument(std::execution::seq, document_id);
+}
+
+void ShardedSearchServer::Compact() {
+    std::vector<std::future<void>> futures;
+    futures.reserve(shards_.size());
+    for (SearchServer& shard : shards_) {
+        futures.push_back(thread_pool_.Submit([&shard]() {
+            shard.Compact();
+        }));
+    }
+
+    // every future is waited for before an exception leaves, the tasks refer to the shards
+    for (std::future<void>& future : futures) {
+        future.wait();
+    }
+    for (std::future<void>& future : futures) {
+        future.get();
+    }
+}
+
+std::vector<Document> ShardedSearchServer::FindTopDocuments(std::string_view raw_query) const {
+    return FindTopDocuments(std::execution::par, raw_query);
+}
+
+std::vector<Document> ShardedSearchServer::FindTopDocuments(std::string_view raw_query, DocumentStatus status) const {
+    return FindTopDocuments(std::execution::par, raw_query, status);
+}
+
+std::tuple<std::vector<std::string_view>, DocumentStatus> ShardedSearchServer::MatchDocument(
+    std::string_view raw_query, int document_id) const {
+    return MatchDocument(std::execution::seq, raw_query, document_id);
+}
+
+int ShardedSearchServer::GetDocumentCount() const {
+    int document_count = 0;
+
+    for (const SearchServer& shard : shards_) {
+        document_count += shard.GetDocumentCount();
+    }
+
+    return document_count;
+}
+
+size_t ShardedSearchServer::GetShardCount() const {
+    return shards_.size();
+}
+
+std::map<std::string_view, double> ShardedSearchServer::GetWordFrequencies(int document_id) const {
+    return GetShard(document_id).GetWordFrequencies(document_id);
+}
+
+size_t ShardedSearchServer::GetShardIndex(int document_id) const {
+    return std::hash<int>{}(document_id) % shards_.size();
+}
+
+const SearchServer& ShardedSearchServer::GetShard(int document_id) const {
+    return shards_[GetShardIndex(document_id)];
+}
+
+SearchServer& ShardedSearchServer::GetShard(int document_id) {
+    return shards_[GetShardIndex(document_id)];
+}
+
+CollectionStatistics ShardedSearchServer::ComputeStatistics(std::string_view raw_query) const {
+    CollectionStatistics statistics = shards_.front().GetStatistics(raw_query);
+
+    for (size_t i = 1; i < shards_.size(); ++i) {
+        const CollectionStatistics shard_statistics = shards_[i].GetStatistics(raw_query);
+        statistics.document_count += shard_statistics.document_count;
+
+        // patterns may match different terms in different shards
+        for (const auto& [word, document_freq] : shard_statistics.document_freqs) {
+            statistics.document_freqs[word] += document_freq;
+        }
+    }
+
+    return statistics;
+}
@@ -0,0 +1,150 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <execution>
+#include <future>
+#include <map>
+#include <string_view>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+#include "../helpers/thread_pool/thread_pool.h"
+#include "document.h"
+#include "search_server.h"
+
+// Index partitioned by document id into shards. A parallel query runs on every shard in a thread
+// pool with the statistics of the whole collection, and the shards' tops are merged, so the result
+// is the same as a single SearchServer with the same documents gives. Like SearchServer, it may be
+// queried from several threads at once, but not while documents are added or removed
+class ShardedSearchServer {
+   public:
+    explicit ShardedSearchServer(std::string_view stop_words, size_t shard_count = std::max(std::thread::hardware_concurrency(), 1u));
+
+    void AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings);
+
+    template <typename ExecutionPolicy>
+    void RemoveDocument(ExecutionPolicy&& policy, int document_id);
+    void RemoveDocument(int document_id);
+    // the documents are tombstoned by their shards, see SearchServer::RemoveDocuments
+    template <typename DocumentIdRange>
+    void RemoveDocuments(const DocumentIdRange& document_ids);
+    // compacts the shards in the thread pool
+    void Compact();
+
+    // a sequential query runs on the shards one after another in the calling thread,
+    // a query without a policy is parallel
+    template <typename ExecutionPolicy, typename Comparator>
+    std::vector<Document> FindTopDocuments(ExecutionPolicy&& policy, std::string_view raw_query, Comparator comparator) const;
+    template <typename ExecutionPolicy>
+    std::vector<Document> FindTopDocuments(ExecutionPolicy&& policy, std::string_view raw_query) const;
+    template <typename ExecutionPolicy>
+    std::vector<Document> FindTopDocuments(ExecutionPolicy&& policy, std::string_view raw_query, DocumentStatus status) const;
+    template <typename Comparator>
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, Comparator comparator) const;
+    std::vector<Document> FindTopDocuments(std::string_view raw_query) const;
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentStatus status) const;
+
+    template <typename ExecutionPolicy>
+    std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(ExecutionPolicy&& policy,
+                                                                            std::string_view raw_query, int document_id) const;
+    std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(std::string_view raw_query, int document_id) const;
+
+    int GetDocumentCount() const;
+    size_t GetShardCount() const;
+
+    std::map<std::string_view, double> GetWordFrequencies(int document_id) const;
+
+   private:
+    std::vector<SearchServer> shards_;
+    // mutable since queries submit their work to it
+    mutable ThreadPool thread_pool_;
+
+    size_t GetShardIndex(int document_id) const;
+    const SearchServer& GetShard(int document_id) const;
+    SearchServer& GetShard(int document_id);
+
+    // sums up the shards' statistics, throws if the query is invalid
+    CollectionStatistics ComputeStatistics(std::string_view raw_query) const;
+};
+
+template <typename ExecutionPolicy>
+void ShardedSearchServer::RemoveDocument(ExecutionPolicy&& policy, int document_id) {
+    GetShard(document_id).RemoveDocument(policy, document_id);
+}
+
+template <typename DocumentIdRange>
+void ShardedSearchServer::RemoveDocuments(const DocumentIdRange& document_ids) {
+    std::vector<std::vector<int>> shard_document_ids(shards_.size());
+    for (const int document_id : document_ids) {
+        shard_document_ids[GetShardIndex(document_id)].push_back(document_id);
+    }
+
+    for (size_t i = 0; i < shards_.size(); ++i) {
+        shards_[i].RemoveDocuments(shard_document_ids[i]);
+    }
+}
+
+template <typename ExecutionPolicy, typename Comparator>
+std::vector<Document> ShardedSearchServer::FindTopDocuments(ExecutionPolicy&&, std::string_view raw_query,
+                                                            Comparator comparator) const {
+    // the policy's type decides whether shards are searched on the pool
+    const CollectionStatistics statistics = ComputeStatistics(raw_query);
+    std::vector<std::vector<Document>> shard_documents(shards_.size());
+
+    if constexpr (std::is_same_v<std::decay_t<ExecutionPolicy>, std::execution::sequenced_policy>) {
+        for (size_t i = 0; i < shards_.size(); ++i) {
+            shard_documents[i] = shards_[i].FindTopDocuments(std::execution::seq, raw_query, comparator, statistics);
+        }
+    } else {
+        std::vector<std::future<std::vector<Document>>> futures;
+        futures.reserve(shards_.size());
+        for (const SearchServer& shard : shards_) {
+            futures.push_back(thread_pool_.Submit([&shard, raw_query, &comparator, &statistics]() {
+                return shard.FindTopDocuments(std::execution::seq, raw_query, comparator, statistics);
+            }));
+        }
+
+        // every future is waited for before an exception leaves, the tasks refer to this frame
+        for (size_t i = 0; i < futures.size(); ++i) {
+            futures[i].wait();
+        }
+        for (size_t i = 0; i < futures.size(); ++i) {
+            shard_documents[i] = futures[i].get();
+        }
+    }
+
+    std::vector<Document> documents;
+    for (const std::vector<Document>& top : shard_documents) {
+        documents.insert(documents.end(), top.begin(), top.end());
+    }
+
+    const size_t top_count = std::min(documents.size(), static_cast<size_t>(MAX_RESULT_DOCUMENT_COUNT));
+    std::partial_sort(documents.begin(), documents.begin() + top_count, documents.end(), IsMoreRelevant);
+    documents.resize(top_count);
+
+    return documents;
+}
+
+template <typename ExecutionPolicy>
+std::vector<Document> ShardedSearchServer::FindTopDocuments(ExecutionPolicy&& policy, std::string_view raw_query) const {
+    return FindTopDocuments(policy, raw_query, DocumentStatus::ACTUAL);
+}
+
+template <typename ExecutionPolicy>
+std::vector<Document> ShardedSearchServer::FindTopDocuments(ExecutionPolicy&& policy, std::string_view raw_query,
+                                                            DocumentStatus status) const {
+    return FindTopDocuments(policy, raw_query, ByStatus{status});
+}
+
+template <typename Comparator>
+std::vector<Document> ShardedSearchServer::FindTopDocuments(std::string_view raw_query, Comparator comparator) const {
+    return FindTopDocuments(std::execution::par, raw_query, comparator);
+}
+
+template <typename ExecutionPolicy>
+std::tuple<std::vector<std::string_view>, DocumentStatus> ShardedSearchServer::MatchDocument(
+    ExecutionPolicy&& policy, std::string_view raw_query, int document_id) const {
+    return GetShard(document_id).MatchDocument(policy, raw_query, document_id);
+}
@@ -0,0 +1,361 @@
+#include "term_dictionary.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace {
+
+const size_t INITIAL_SLOT_COUNT = 16;
+
+// pattern positions a trie walk may be at are bits of a mask, the last one means the whole pattern
+const size_t MAX_PATTERN_SIZE = 63;
+
+// adds positions reachable through '*' without taking a character
+uint64_t SkipStars(std::string_view pattern, uint64_t positions) {
+    for (size_t i = 0; i < pattern.size(); ++i) {
+        if ((positions >> i & 1) && pattern[i] == '*') {
+            positions |= uint64_t(1) << (i + 1);
+        }
+    }
+
+    return positions;
+}
+
+uint64_t TakeCharacter(std::string_view pattern, uint64_t positions, char c) {
+    uint64_t next_positions = 0;
+
+    for (size_t i = 0; i < pattern.size(); ++i) {
+        if (!(positions >> i & 1)) {
+            continue;
+        }
+
+        if (pattern[i] == '*') {
+            next_positions |= uint64_t(1) << i;
+        } else if (pattern[i] == '?' || pattern[i] == c) {
+            next_positions |= uint64_t(1) << (i + 1);
+        }
+    }
+
+    return SkipStars(pattern, next_positions);
+}
+
+// the order of std::string
+bool IsLess(char lhs, char rhs) {
+    return static_cast<unsigned char>(lhs) < static_cast<unsigned char>(rhs);
+}
+
+}  // namespace
+
+TermDictionary::TermDictionary() {
+    slots_.Edit().assign(INITIAL_SLOT_COUNT, NO_TERM);
+    trie_nodes_.Edit().push_back({NO_NODE, NO_NODE, NO_TERM, '\0'});
+}
+
+// views of inserted terms must point to the own storage
+TermDictionary::TermDictionary(const TermDictionary& other)
+    : loaded_chars_(other.loaded_chars_),
+      loaded_offsets_(other.loaded_offsets_),
+      storage_(other.storage_),
+      slots_(other.slots_),
+      trie_nodes_(other.trie_nodes_),
+      laid_out_node_count_(other.laid_out_node_count_) {
+    inserted_terms_.assign(storage_.begin(), storage_.end());
+}
+
+TermDictionary& TermDictionary::operator=(const TermDictionary& rhs) {
+    if (this != &rhs) {
+        TermDictionary copy(rhs);
+        *this = std::move(copy);
+    }
+
+    return *this;
+}
+
+TermId TermDictionary::Find(std::string_view term) const {
+    return slots_[FindSlot(term)];
+}
+
+TermId TermDictionary::Insert(std::string_view term) {
+    size_t slot = FindSlot(term);
+
+    if (slots_[slot] != NO_TERM) {
+        return slots_[slot];
+    }
+
+    // keep load factor below 1/2 to make probe sequences short
+    if ((GetTermCount() + 1) * 2 > slots_.size()) {
+        Rehash(slots_.size() * 2);
+        slot = FindSlot(term);
+    }
+
+    const TermId term_id = static_cast<TermId>(GetTermCount());
+    const std::string& stored = storage_.emplace_back(term);
+    inserted_terms_.push_back(stored);
+    slots_.Edit()[slot] = term_id;
+    InsertIntoTrie(term, term_id);
+
+    return term_id;
+}
+
+std::string_view TermDictionary::GetTerm(TermId term_id) const {
+    const size_t loaded_term_count = GetLoadedTermCount();
+
+    if (term_id < loaded_term_count) {
+        const uint64_t begin = loaded_offsets_[term_id];
+
+        return std::string_view(loaded_chars_.data() + begin, loaded_offsets_[term_id + 1] - begin);
+    }
+
+    return inserted_terms_.at(term_id - loaded_term_count);
+}
+
+size_t TermDictionary::GetTermCount() const {
+    return GetLoadedTermCount() + inserted_terms_.size();
+}
+
+bool TermDictionary::IsPattern(std::string_view word) {
+    return word.find_first_of("*?") != std::string_view::npos;
+}
+
+void TermDictionary::FindMatching(std::string_view pattern, size_t max_count, std::vector<TermId>& term_ids) const {
+    using namespace std::string_literals;
+
+    if (pattern.size() > MAX_PATTERN_SIZE) {
+        throw std::invalid_argument("Pattern mustn't be longer than "s + std::to_string(MAX_PATTERN_SIZE) + " characters"s);
+    }
+
+    const uint64_t whole_pattern = uint64_t(1) << pattern.size();
+    size_t count = 0;
+
+    // (node, positions before its label); a node's next sibling is taken after its subtree,
+    // so terms come in lexicographical order
+    std::vector<std::pair<uint32_t, uint64_t>> stack = {{trie_nodes_[0].first_child, SkipStars(pattern, 1)}};
+    while (!stack.empty() && count < max_count) {
+        const auto [node_index, parent_positions] = stack.back();
+        stack.pop_back();
+        if (node_index == NO_NODE) {
+            continue;
+        }
+
+        const TrieNode& node = trie_nodes_[node_index];
+        stack.emplace_back(node.next_sibling, parent_positions);
+
+        // no position left means no term of the subtree matches
+        const uint64_t positions = TakeCharacter(pattern, parent_positions, node.label);
+        if (positions == 0) {
+            continue;
+        }
+
+        if (node.term_id != NO_TERM && (positions & whole_pattern)) {
+            term_ids.push_back(node.term_id);
+            ++count;
+        }
+        stack.emplace_back(node.first_child, positions);
+    }
+}
+
+void TermDictionary::Save(IndexWriter& writer) const {
+    std::vector<char> chars;
+    std::vector<uint64_t> offsets = {0};
+
+    for (TermId term_id = 0; term_id < GetTermCount(); ++term_id) {
+        const std::string_view term = GetTerm(term_id);
+
+        chars.insert(chars.end(), term.begin(), term.end());
+        offsets.push_back(chars.size());
+    }
+
+    writer.WriteArray(chars);
+    writer.WriteArray(offsets);
+    writer.WriteArray(slots_);
+    writer.WriteArray(LayOutTrie());
+}
+
+TermDictionary TermDictionary::Load(IndexReader& reader) {
+    TermDictionary dictionary;
+    dictionary.loaded_chars_ = reader.ReadArray<char>();
+    dictionary.loaded_offsets_ = reader.ReadArray<uint64_t>();
+    dictionary.slots_ = reader.ReadArray<TermId>();
+    dictionary.trie_nodes_ = reader.ReadArray<TrieNode>();
+    dictionary.laid_out_node_count_ = dictionary.trie_nodes_.size();
+
+    return dictionary;
+}
+
+size_t TermDictionary::GetLoadedTermCount() const {
+    return loaded_offsets_.empty() ? 0u : loaded_offsets_.size() - 1;
+}
+
+size_t TermDictionary::FindSlot(std::string_view term) const {
+    // slot count is always a power of two
+    const size_t mask = slots_.size() - 1;
+    size_t slot = std::hash<std::string_view>{}(term) & mask;
+
+    while (slots_[slot] != NO_TERM && GetTerm(slots_[slot]) != term) {
+        slot = (slot + 1) & mask;
+    }
+
+    return slot;
+}
+
+void TermDictionary::Rehash(size_t slot_count) {
+    std::vector<TermId>& slots = slots_.Edit();
+    slots.assign(slot_count, NO_TERM);
+
+    const size_t mask = slot_count - 1;
+    for (TermId term_id = 0; term_id < GetTermCount(); ++term_id) {
+        size_t slot = std::hash<std::string_view>{}(GetTerm(term_id)) & mask;
+
+        while (slots[slot] != NO_TERM) {
+            slot = (slot + 1) & mask;
+        }
+
+        slots[slot] = term_id;
+    }
+}
+
+void TermDictionary::FindSimilar(std::string_view word, int max_distance, size_t max_count,
+                                 std::vector<std::pair<TermId, int>>& terms) const {
+    using namespace std::string_literals;
+
+    if (max_distance >= UINT8_MAX) {
+        throw std::invalid_argument("Edit distance must be less than "s + std::to_string(UINT8_MAX));
+    }
+    if (max_count == 0 || max_distance < 0) {
+        return;
+    }
+
+    // distances above max_distance are all the same for the search, so they fit in a byte
+    const auto cap = [&max_distance](size_t distance) {
+        return static_cast<uint8_t>(std::min(distance, static_cast<size_t>(max_distance) + 1));
+    };
+
+    // row of a level: distances from the prefix of that length to every prefix of the word. Levels
+    // deeper than word.size() + max_distance are never reached, since the distance only grows there
+    const size_t row_size = word.size() + 1;
+    std::vector<uint8_t> rows((word.size() + max_distance + 2) * row_size, cap(SIZE_MAX));
+    for (size_t i = 0; i < row_size; ++i) {
+        rows[i] = cap(i);
+    }
+    // stays the same when max_distance gets smaller, so cells out of the band are never written
+    const size_t band_width = max_distance;
+
+    const size_t first_found = terms.size();
+    // found terms by distance; once max_count of them are close enough, farther ones aren't looked for
+    std::vector<size_t> found_counts(max_distance + 1);
+
+    std::vector<std::pair<uint32_t, size_t>> stack = {{trie_nodes_[0].first_child, 1}};
+    while (!stack.empty()) {
+        const auto [node_index, depth] = stack.back();
+        stack.pop_back();
+        if (node_index == NO_NODE) {
+            continue;
+        }
+
+        const TrieNode& node = trie_nodes_[node_index];
+        stack.emplace_back(node.next_sibling, depth);
+
+        const uint8_t* previous = rows.data() + (depth - 1) * row_size;
+        uint8_t* row = rows.data() + depth * row_size;
+        row[0] = cap(depth);
+        uint8_t min_distance = row[0];
+        // only a band around the diagonal may be close enough, the rest of a row stays far
+        const size_t band_begin = std::max(depth, band_width + 1) - band_width;
+        const size_t band_end = std::min(depth + band_width + 1, row_size);
+        for (size_t i = band_begin; i < band_end; ++i) {
+            const size_t substitution = previous[i - 1] + (word[i - 1] == node.label ? 0 : 1);
+            row[i] = cap(std::min({substitution, previous[i] + size_t(1), row[i - 1] + size_t(1)}));
+            min_distance = std::min(min_distance, row[i]);
+        }
+
+        const int distance = row[word.size()];
+        if (node.term_id != NO_TERM && distance <= max_distance) {
+            terms.emplace_back(node.term_id, distance);
+
+            size_t closer_count = 0;
+            for (int i = 0; i <= max_distance; ++i) {
+                closer_count += found_counts[i] + (i == distance ? 1 : 0);
+                if (closer_count >= max_count) {
+                    max_distance = i;
+                    break;
+                }
+            }
+            ++found_counts[distance];
+        }
+
+        if (min_distance <= max_distance) {
+            stack.emplace_back(node.first_child, depth + 1);
+        }
+    }
+
+    // terms of the same distance stay in lexicographical order
+    std::stable_sort(terms.begin() + first_found, terms.end(), [](const auto& lhs, const auto& rhs) {
+        return lhs.second < rhs.second;
+    });
+    terms.resize(std::min(terms.size(), first_found + max_count));
+}
+
+void TermDictionary::InsertIntoTrie(std::string_view term, TermId term_id) {
+    std::vector<TrieNode>& nodes = trie_nodes_.Edit();
+    uint32_t node_index = 0;
+
+    for (const char c : term) {
+        // the link to the first sibling not less than c, the new node goes in its place if it isn't c
+        uint32_t* link = &nodes[node_index].first_child;
+        while (*link != NO_NODE && IsLess(nodes[*link].label, c)) {
+            link = &nodes[*link].next_sibling;
+        }
+
+        if (*link != NO_NODE && nodes[*link].label == c) {
+            node_index = *link;
+            continue;
+        }
+
+        // the link points into the vector, so it's set before the vector grows
+        const uint32_t next_sibling = *link;
+        node_index = static_cast<uint32_t>(nodes.size());
+        *link = node_index;
+        nodes.push_back({NO_NODE, next_sibling, NO_TERM, c});
+    }
+
+    nodes[node_index].term_id = term_id;
+
+    if (nodes.size() >= 2 * laid_out_node_count_) {
+        trie_nodes_.Edit() = LayOutTrie();
+        laid_out_node_count_ = trie_nodes_.size();
+    }
+}
+
+std::vector<TermDictionary::TrieNode> TermDictionary::LayOutTrie() const {
+    std::vector<TrieNode> nodes = {trie_nodes_[0]};
+    nodes.reserve(trie_nodes_.size());
+    // where the laid out nodes were
+    std::vector<uint32_t> source_indexes = {0};
+    source_indexes.reserve(trie_nodes_.size());
+
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        uint32_t child_index = trie_nodes_[source_indexes[i]].first_child;
+        if (child_index == NO_NODE) {
+            continue;
+        }
+
+        nodes[i].first_child = static_cast<uint32_t>(nodes.size());
+        while (child_index != NO_NODE) {
+            const TrieNode& child = trie_nodes_[child_index];
+            // the next sibling goes right after the child
+            const uint32_t next_sibling = child.next_sibling == NO_NODE ? NO_NODE : static_cast<uint32_t>(nodes.size() + 1);
+
+            nodes.push_back({NO_NODE, next_sibling, child.term_id, child.label});
+            source_indexes.push_back(child_index);
+            child_index = child.next_sibling;
+        }
+    }
+
+    return nodes;
+}
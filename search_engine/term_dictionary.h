@@ -0,0 +1,79 @@
+#pragma once
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "index_file.h"
+#include "mappable_vector.h"
+
+using TermId = uint32_t;
+
+const TermId NO_TERM = UINT32_MAX;
+
+// Interns words into dense ids [0, GetTermCount()). Lookup by std::string_view doesn't allocate,
+// and string_views returned by GetTerm stay valid for the whole life of the dictionary. Terms are
+// also kept in a trie, which finds terms by a pattern without looking at the other terms
+class TermDictionary {
+   public:
+    TermDictionary();
+    TermDictionary(const TermDictionary& other);
+    TermDictionary(TermDictionary&& other) = default;
+    TermDictionary& operator=(const TermDictionary& rhs);
+    TermDictionary& operator=(TermDictionary&& rhs) = default;
+
+    TermId Find(std::string_view term) const;
+    TermId Insert(std::string_view term);
+
+    std::string_view GetTerm(TermId term_id) const;
+    size_t GetTermCount() const;
+
+    // a pattern has '*' standing for any string, '?' standing for any character, or both
+    static bool IsPattern(std::string_view word);
+    // Appends ids of the terms matching the pattern in lexicographical order, at most max_count of
+    // them. A pattern starting with a wildcard looks at the whole trie, a prefix one only at its subtree
+    void FindMatching(std::string_view pattern, size_t max_count, std::vector<TermId>& term_ids) const;
+    // Appends (id, edit distance) of at most max_count terms within max_distance insertions, deletions
+    // and substitutions of the word, the closest first. The trie is walked with a row of the distance
+    // matrix per level, and a subtree is left as soon as no term of it can be close enough
+    void FindSimilar(std::string_view word, int max_distance, size_t max_count,
+                     std::vector<std::pair<TermId, int>>& terms) const;
+
+    void Save(IndexWriter& writer) const;
+    // refers to the reader's file data without copying
+    static TermDictionary Load(IndexReader& reader);
+
+   private:
+    // terms loaded from a file: the term with id i is at [offsets[i], offsets[i + 1]) of the chars
+    MappableVector<char> loaded_chars_;
+    MappableVector<uint64_t> loaded_offsets_;
+    // terms inserted after loading; deque doesn't relocate its elements, so views never dangle
+    std::deque<std::string> storage_;
+    std::vector<std::string_view> inserted_terms_;
+    // open addressing table with linear probing, NO_TERM marks an empty slot
+    MappableVector<TermId> slots_;
+
+    static constexpr uint32_t NO_NODE = UINT32_MAX;
+
+    // children of a node are a list of siblings ordered by label, the root is the first node
+    struct TrieNode {
+        uint32_t first_child;
+        uint32_t next_sibling;
+        TermId term_id;  // of the term ending here, NO_TERM if none does
+        char label;
+    };
+
+    MappableVector<TrieNode> trie_nodes_;
+    size_t laid_out_node_count_ = 1;
+
+    size_t GetLoadedTermCount() const;
+    size_t FindSlot(std::string_view term) const;
+    void Rehash(size_t slot_count);
+    void InsertIntoTrie(std::string_view term, TermId term_id);
+    // Same trie with children of every node next to each other, level by level, so a walk reads
+    // them from one place instead of wherever they were inserted. Nodes are laid out so when saving
+    // and whenever their count doubles
+    std::vector<TrieNode> LayOutTrie() const;
+};
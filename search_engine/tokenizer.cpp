@@ -0,0 +1,122 @@
+#include "tokenizer.h"
+
+#include <cstddef>
+#include <string_view>
+#include <vector>
+
+#include "term_dictionary.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+const size_t NO_WORD = std::string_view::npos;
+
+bool IsSpecialCharacter(char c) {
+    return c >= '\0' && c < ' ';
+}
+
+// the word which has the character at the position, the character isn't a space
+std::string_view GetWordAt(std::string_view text, size_t position) {
+    const size_t space_before = text.rfind(' ', position);
+    const size_t begin = space_before == text.npos ? 0 : space_before + 1;
+    const size_t end = text.find(' ', position);
+
+    return text.substr(begin, end == text.npos ? text.npos : end - begin);
+}
+
+}  // namespace
+
+void Tokenizer::AddStopWord(std::string_view word) {
+    stop_words_.Insert(word);
+}
+
+bool Tokenizer::IsStopWord(std::string_view word) const {
+    return stop_words_.Find(word) != NO_TERM;
+}
+
+std::vector<std::string_view> Tokenizer::GetStopWords() const {
+    std::vector<std::string_view> stop_words;
+
+    for (TermId term_id = 0; term_id < stop_words_.GetTermCount(); ++term_id) {
+        stop_words.push_back(stop_words_.GetTerm(term_id));
+    }
+
+    return stop_words;
+}
+
+std::string_view Tokenizer::Split(std::string_view text, bool skip_stop_words, std::vector<std::string_view>& words) const {
+    words.clear();
+
+    const auto add_word = [&](size_t begin, size_t end) {
+        const std::string_view word = text.substr(begin, end - begin);
+
+        if (!skip_stop_words || !IsStopWord(word)) {
+            words.push_back(word);
+        }
+    };
+
+    size_t word_begin = NO_WORD;
+    size_t position = 0;
+
+#if defined(__SSE2__)
+    const size_t chunk_size = sizeof(__m128i);
+    const __m128i spaces = _mm_set1_epi8(' ');
+    const __m128i minus_ones = _mm_set1_epi8(-1);
+
+    for (; position + chunk_size <= text.size(); position += chunk_size) {
+        const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text.data() + position));
+
+        // bytes are signed, so the characters above 127 are below a space too
+        const __m128i is_special = _mm_and_si128(_mm_cmplt_epi8(chunk, spaces), _mm_cmpgt_epi8(chunk, minus_ones));
+        const unsigned special_mask = static_cast<unsigned>(_mm_movemask_epi8(is_special));
+        if (special_mask != 0u) {
+            return GetWordAt(text, position + __builtin_ctz(special_mask));
+        }
+
+        // a bit is set where a character differs from the previous one in being a space,
+        // that is where a word begins or ends
+        const unsigned space_mask = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, spaces)));
+        const unsigned previous_space_mask = (space_mask << 1) | (word_begin == NO_WORD ? 1u : 0u);
+        unsigned boundary_mask = (space_mask ^ previous_space_mask) & 0xFFFFu;
+
+        while (boundary_mask != 0u) {
+            const size_t boundary = position + __builtin_ctz(boundary_mask);
+
+            if (word_begin == NO_WORD) {
+                word_begin = boundary;
+            } else {
+                add_word(word_begin, boundary);
+                word_begin = NO_WORD;
+            }
+
+            boundary_mask &= boundary_mask - 1;
+        }
+    }
+#endif
+
+    for (; position < text.size(); ++position) {
+        const char c = text[position];
+
+        if (IsSpecialCharacter(c)) {
+            return GetWordAt(text, position);
+        }
+
+        if (c != ' ') {
+            if (word_begin == NO_WORD) {
+                word_begin = position;
+            }
+        } else if (word_begin != NO_WORD) {
+            add_word(word_begin, position);
+            word_begin = NO_WORD;
+        }
+    }
+
+    if (word_begin != NO_WORD) {
+        add_word(word_begin, text.size());
+    }
+
+    return {};
+}
@@ -0,0 +1,23 @@
+#pragma once
+#include <string_view>
+#include <vector>
+
+#include "term_dictionary.h"
+
+// Splits texts into words separated by spaces. Splitting, the check for special (control) characters
+// and dropping of stop words are done in one pass over a text, by 16 characters where SSE2 is available
+class Tokenizer {
+   public:
+    void AddStopWord(std::string_view word);
+    bool IsStopWord(std::string_view word) const;
+    std::vector<std::string_view> GetStopWords() const;
+
+    // Words go to the buffer, which is cleared first, so its memory is reused from text to text.
+    // Returns the first word with special characters, the text isn't split further then; returns
+    // an empty view if there are no such words
+    std::string_view Split(std::string_view text, bool skip_stop_words, std::vector<std::string_view>& words) const;
+
+   private:
+    // flat hash table, a lookup costs a hash and usually one comparison
+    TermDictionary stop_words_;
+};
@@ -0,0 +1,43 @@
+#include "top_documents.h"
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include "document.h"
+
+TopDocuments::TopDocuments(size_t capacity) : capacity_(capacity) {
+    heap_.reserve(capacity);
+}
+
+bool TopDocuments::IsFull() const {
+    return heap_.size() == capacity_;
+}
+
+const Document& TopDocuments::GetWorst() const {
+    return heap_.front();
+}
+
+void TopDocuments::Push(const Document& document) {
+    if (capacity_ == 0u) {
+        return;
+    }
+
+    if (IsFull()) {
+        if (!IsMoreRelevant(document, heap_.front())) {
+            return;
+        }
+
+        std::pop_heap(heap_.begin(), heap_.end(), IsMoreRelevant);
+        heap_.pop_back();
+    }
+
+    heap_.push_back(document);
+    std::push_heap(heap_.begin(), heap_.end(), IsMoreRelevant);
+}
+
+std::vector<Document> TopDocuments::Extract() {
+    std::sort_heap(heap_.begin(), heap_.end(), IsMoreRelevant);
+
+    return std::exchange(heap_, {});
+}
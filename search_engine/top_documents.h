@@ -0,0 +1,24 @@
+#pragma once
+#include <vector>
+
+#include "document.h"
+
+// Bounded heap keeping the most relevant of the pushed documents
+class TopDocuments {
+   public:
+    explicit TopDocuments(size_t capacity);
+
+    bool IsFull() const;
+
+    // the least relevant of the kept documents, the heap mustn't be empty
+    const Document& GetWorst() const;
+
+    void Push(const Document& document);
+
+    // kept documents from the most relevant one, the heap becomes empty
+    std::vector<Document> Extract();
+
+   private:
+    size_t capacity_;
+    std::vector<Document> heap_;
+};